@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+// Enough for pointers, size_t and double; keeps small records such as AST nodes dense
+#define ARENA_ALIGN ((size_t)8)
+
+static size_t alignUp(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+void arenaInit(Arena *arena, size_t sizeHint) {
+    arena->head = NULL;
+    arena->blockSize = sizeHint > 0 ? alignUp(sizeHint) : ARENA_DEFAULT_BLOCK;
+}
+
+static ArenaBlock *arenaAddBlock(Arena *arena, size_t minimum) {
+    size_t size = arena->blockSize > minimum ? arena->blockSize : minimum;
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (!block) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    block->next = arena->head;
+    block->size = size;
+    block->used = 0;
+    arena->head = block;
+    // Each block doubles the next one, so a bad size hint still costs few allocations
+    arena->blockSize = size * 2;
+    return block;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = alignUp(size > 0 ? size : 1);
+    ArenaBlock *block = arena->head;
+    if (!block || block->size - block->used < size) {
+        block = arenaAddBlock(arena, size);
+    }
+    void *result = (char *)block->data + block->used;
+    block->used += size;
+    return result;
+}
+
+void *arenaGrow(Arena *arena, void *old, size_t oldSize, size_t newSize) {
+    if (old == NULL) {
+        return arenaAlloc(arena, newSize);
+    }
+    ArenaBlock *block = arena->head;
+    size_t oldAligned = alignUp(oldSize > 0 ? oldSize : 1);
+    size_t newAligned = alignUp(newSize > 0 ? newSize : 1);
+    if ((char *)old + oldAligned == (char *)block->data + block->used &&
+        block->used - oldAligned + newAligned <= block->size) {
+        block->used = block->used - oldAligned + newAligned;
+        return old;
+    }
+    void *result = arenaAlloc(arena, newSize);
+    memcpy(result, old, oldSize < newSize ? oldSize : newSize);
+    return result;
+}
+
+void arenaFree(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+}
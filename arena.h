@@ -0,0 +1,32 @@
+// arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator. Allocations are carved out of large blocks and are never freed one by
+// one; arenaFree() releases everything with one free() per block.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;     // block currently being filled
+    size_t blockSize;     // size of the next block to allocate
+} Arena;
+
+// sizeHint is the number of bytes the caller expects to need; 0 picks a default
+void arenaInit(Arena *arena, size_t sizeHint);
+
+void *arenaAlloc(Arena *arena, size_t size);
+
+// Resize the most recent allocation in place when it is at the end of the current block,
+// otherwise copy it to fresh space. The old space is reclaimed only by arenaFree().
+void *arenaGrow(Arena *arena, void *old, size_t oldSize, size_t newSize);
+
+void arenaFree(Arena *arena);
+
+#endif // ARENA_H
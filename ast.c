@@ -0,0 +1,523 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Literals and names carry a value and blocks a list of statements; every other node
+// carries two children
+static int hasChildren(TokenType type) {
+    return type != TOKEN_IDENTIFIER && type != TOKEN_INT_LITERAL && type != TOKEN_DOUBLE_LITERAL &&
+           type != TOKEN_NEW_LINE;
+}
+
+// Declarations and prints run their right child first, and a division checks its divisor
+// before it evaluates the dividend
+static int visitsRightFirst(TokenType type) {
+    return type == TOKEN_PRINT || type == TOKEN_INT_DECL || type == TOKEN_DOUBLE_DECL || type == TOKEN_DIVISION;
+}
+
+static void *checkedRealloc(void *old, size_t size) {
+    void *result = realloc(old, size);
+    if (!result) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+// A node waiting for its children to be flattened
+typedef struct {
+    const Node *node;
+    int visited;                // children done so far
+    AstIndex children[2];       // their indexes, in visiting order
+    size_t pendingStart;        // for a block, where its statements start in Flattener.pending
+} FlattenFrame;
+
+typedef struct {
+    FlatAst *ast;
+    size_t capacity;
+    size_t statementCapacity;
+    FlattenFrame *stack;
+    size_t depth;
+    size_t stackCapacity;
+    AstIndex *pending;          // statements of the open blocks, innermost last
+    size_t pendingSize;
+    size_t pendingCapacity;
+} Flattener;
+
+static void pushFrame(Flattener *flattener, const Node *node) {
+    if (flattener->depth == flattener->stackCapacity) {
+        flattener->stackCapacity = flattener->stackCapacity < 64 ? 64 : flattener->stackCapacity * 2;
+        flattener->stack = (FlattenFrame *)checkedRealloc(flattener->stack, flattener->stackCapacity * sizeof(FlattenFrame));
+    }
+    FlattenFrame *frame = &flattener->stack[flattener->depth++];
+    frame->node = node;
+    frame->visited = 0;
+    frame->pendingStart = flattener->pendingSize;
+}
+
+static void addPending(Flattener *flattener, AstIndex index) {
+    if (flattener->pendingSize == flattener->pendingCapacity) {
+        flattener->pendingCapacity = flattener->pendingCapacity < 256 ? 256 : flattener->pendingCapacity * 2;
+        flattener->pending = (AstIndex *)checkedRealloc(flattener->pending, flattener->pendingCapacity * sizeof(AstIndex));
+    }
+    flattener->pending[flattener->pendingSize++] = index;
+}
+
+// Move the statements of the block in frame from pending to the end of ast->statements
+static void emitStatements(Flattener *flattener, const FlattenFrame *frame, AstOperand *operand) {
+    FlatAst *ast = flattener->ast;
+    size_t count = flattener->pendingSize - frame->pendingStart;
+    size_t needed = (size_t)ast->statementCount + count;
+    if (needed > flattener->statementCapacity) {
+        while (needed > flattener->statementCapacity) {
+            flattener->statementCapacity = flattener->statementCapacity < 256 ? 256 : flattener->statementCapacity * 2;
+        }
+        ast->statements = (AstIndex *)checkedRealloc(ast->statements, flattener->statementCapacity * sizeof(AstIndex));
+    }
+    memcpy(ast->statements + ast->statementCount, flattener->pending + frame->pendingStart, count * sizeof(AstIndex));
+    operand->first = ast->statementCount;
+    operand->count = (AstIndex)count;
+    ast->statementCount += (AstIndex)count;
+    flattener->pendingSize = frame->pendingStart;
+}
+
+static AstIndex emitNode(Flattener *flattener, const FlattenFrame *frame) {
+    FlatAst *ast = flattener->ast;
+    if ((size_t)ast->size == flattener->capacity) {
+        if (flattener->capacity >= INT32_MAX / 2) {
+            fprintf(stderr, "Error: Program too large\n");
+            exit(EXIT_FAILURE);
+        }
+        flattener->capacity = flattener->capacity < 256 ? 256 : flattener->capacity * 2;
+        ast->opcodes = (uint8_t *)checkedRealloc(ast->opcodes, flattener->capacity);
+        ast->operands = (AstOperand *)checkedRealloc(ast->operands, flattener->capacity * sizeof(AstOperand));
+    }
+
+    const Node *node = frame->node;
+    AstIndex index = ast->size++;
+    AstOperand *operand = &ast->operands[index];
+    operand->left = AST_NONE;   // every byte is set, so cache entries are reproducible
+    operand->right = AST_NONE;
+    ast->opcodes[index] = node->type;
+    if (node->type == TOKEN_IDENTIFIER) {
+        operand->symbol = node->symbol;
+    } else if (node->type == TOKEN_INT_LITERAL) {
+        operand->intValue = node->intValue;
+    } else if (node->type == TOKEN_DOUBLE_LITERAL) {
+        operand->doubleValue = node->doubleValue;
+    } else if (node->type == TOKEN_NEW_LINE) {
+        emitStatements(flattener, frame, operand);
+    } else if (visitsRightFirst(node->type)) {
+        operand->right = frame->children[0];
+        operand->left = frame->children[1];
+    } else {
+        operand->left = frame->children[0];
+        operand->right = frame->children[1];
+    }
+    return index;
+}
+
+// Post-order walk with an explicit stack, so a long chain of statements cannot overflow
+// the C stack
+void flattenAst(const Node *root, FlatAst *ast) {
+    ast->opcodes = NULL;
+    ast->operands = NULL;
+    ast->size = 0;
+    ast->statements = NULL;
+    ast->statementCount = 0;
+    ast->root = AST_NONE;
+    ast->mapping = NULL;
+    ast->mappingLength = 0;
+    if (!root) {
+        return;
+    }
+
+    Flattener flattener = {ast, 0, 0, NULL, 0, 0, NULL, 0, 0};
+    pushFrame(&flattener, root);
+    while (flattener.depth > 0) {
+        FlattenFrame *frame = &flattener.stack[flattener.depth - 1];
+        const Node *node = frame->node;
+        if (node->type == TOKEN_NEW_LINE && frame->visited < node->statementCount) {
+            pushFrame(&flattener, node->statements[frame->visited]);
+            continue;
+        } else if (frame->visited < 2 && hasChildren(node->type)) {
+            int rightFirst = visitsRightFirst(node->type);
+            const Node *child = (frame->visited == 0) == rightFirst ? node->right : node->left;
+            if (child) {
+                pushFrame(&flattener, child);
+            } else {
+                frame->children[frame->visited++] = AST_NONE;
+            }
+            continue;
+        }
+
+        AstIndex index = emitNode(&flattener, frame);
+        flattener.depth--;
+        if (flattener.depth > 0) {
+            FlattenFrame *parent = &flattener.stack[flattener.depth - 1];
+            if (parent->node->type == TOKEN_NEW_LINE) {
+                addPending(&flattener, index);
+                parent->visited++;
+            } else {
+                parent->children[parent->visited++] = index;
+            }
+        } else {
+            ast->root = index;
+        }
+    }
+    free(flattener.stack);
+    free(flattener.pending);
+}
+
+void freeFlatAst(FlatAst *ast) {
+#ifndef _WIN32
+    if (ast->mapping != NULL) {
+        munmap(ast->mapping, ast->mappingLength);
+    } else
+#endif
+    {
+        free(ast->opcodes);
+        free(ast->operands);
+        free(ast->statements);
+    }
+    ast->opcodes = NULL;
+    ast->operands = NULL;
+    ast->size = 0;
+    ast->statements = NULL;
+    ast->statementCount = 0;
+    ast->root = AST_NONE;
+    ast->mapping = NULL;
+    ast->mappingLength = 0;
+}
+
+// Cache entry layout: this header, operands[nodeCount], statements[statementCount],
+// opcodes[nodeCount], the names of symbols 0 .. symbolCount - 1, each NUL-terminated, then
+// the sourceLength bytes of the source. Fields are in the writer's byte order; an entry
+// from a machine of the other order fails the format check and is a miss.
+#define AST_CACHE_MAGIC "IWAC"
+#define AST_CACHE_FORMAT 3
+// Set by the build to a digest of the compiler's sources, so any change to the lexer,
+// parser, folding pass or this format makes the old entries misses
+#ifndef IW_COMPILER_VERSION
+#define IW_COMPILER_VERSION "dev"
+#endif
+
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    char compiler[32];          // IW_COMPILER_VERSION, NUL-padded
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    int32_t nodeCount;
+    int32_t root;
+    int32_t statementCount;
+    uint32_t symbolCount;
+    uint32_t nameBytes;
+    uint32_t reserved;          // zero
+} AstCacheHeader;
+
+_Static_assert(sizeof(AstCacheHeader) % sizeof(AstOperand) == 0, "operands must stay aligned after the header");
+
+#ifndef _WIN32
+static void fillCacheHeader(AstCacheHeader *header, uint64_t sourceHash, size_t sourceLength) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, AST_CACHE_MAGIC, sizeof(header->magic));
+    header->format = AST_CACHE_FORMAT;
+    strncpy(header->compiler, IW_COMPILER_VERSION, sizeof(header->compiler) - 1);
+    header->sourceHash = sourceHash;
+    header->sourceLength = sourceLength;
+}
+
+static int cachePath(char *path, size_t size, const char *directory, uint64_t sourceHash, const char *suffix) {
+    int length = snprintf(path, size, "%s/%016llx%s", directory, (unsigned long long)sourceHash, suffix);
+    return length > 0 && (size_t)length < size;
+}
+
+// Check everything the interpreter will trust: the source it was compiled from, sizes,
+// child and statement indexes and symbol IDs
+static int validCacheEntry(const AstCacheHeader *header, const AstCacheHeader *expected, const char *source,
+                           size_t length) {
+    if (memcmp(header, expected, offsetof(AstCacheHeader, nodeCount)) != 0 ||
+        header->nodeCount < 0 || header->root < AST_NONE || header->root >= header->nodeCount ||
+        header->statementCount < 0 || header->statementCount > header->nodeCount) {
+        return 0;
+    }
+    size_t nodeCount = (size_t)header->nodeCount;
+    size_t statementCount = (size_t)header->statementCount;
+    if (length != sizeof(AstCacheHeader) + nodeCount * (sizeof(AstOperand) + 1) +
+                  statementCount * sizeof(AstIndex) + header->nameBytes + header->sourceLength) {
+        return 0;
+    }
+    const AstOperand *operands = (const AstOperand *)(header + 1);
+    const AstIndex *statements = (const AstIndex *)(operands + nodeCount);
+    const uint8_t *opcodes = (const uint8_t *)(statements + statementCount);
+    const char *names = (const char *)(opcodes + nodeCount);
+    if (header->sourceLength > 0 && memcmp(names + header->nameBytes, source, header->sourceLength) != 0) {
+        return 0;
+    }
+    size_t namesFound = 0;
+    for (uint32_t i = 0; i < header->nameBytes; i++) {
+        namesFound += names[i] == '\0';
+    }
+    if (namesFound != header->symbolCount || (header->nameBytes > 0 && names[header->nameBytes - 1] != '\0')) {
+        return 0;
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        TokenType type = (TokenType)opcodes[i];
+        if (type > TOKEN_ERROR) {
+            return 0;
+        } else if (type == TOKEN_IDENTIFIER) {
+            if (operands[i].symbol < SYMBOL_NONE || operands[i].symbol >= (SymbolId)header->symbolCount) {
+                return 0;
+            }
+        } else if (type == TOKEN_NEW_LINE) {
+            if (operands[i].first < 0 || operands[i].count < 0 ||
+                (size_t)operands[i].first + (size_t)operands[i].count > statementCount) {
+                return 0;
+            }
+            for (AstIndex k = 0; k < operands[i].count; k++) {
+                AstIndex statement = statements[operands[i].first + k];
+                if (statement < 0 || statement >= (AstIndex)i) {
+                    return 0;
+                }
+            }
+        } else if (hasChildren(type)) {
+            // Children always come before their parent
+            if (operands[i].left < AST_NONE || operands[i].left >= (AstIndex)i ||
+                operands[i].right < AST_NONE || operands[i].right >= (AstIndex)i) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+typedef struct {
+    char name[32];
+    time_t modified;
+    off_t size;
+} CacheFile;
+
+static int compareCacheFiles(const void *a, const void *b) {
+    time_t x = ((const CacheFile *)a)->modified;
+    time_t y = ((const CacheFile *)b)->modified;
+    return (x > y) - (x < y);
+}
+
+// Remove the least recently used files of the cache directory, other than the entry named
+// kept, until it is within AST_CACHE_MAX_ENTRIES and AST_CACHE_MAX_BYTES. Only names made by
+// cachePath() count, so leftover temporary files go too and nothing else is touched.
+static void pruneAstCache(const char *directory, const char *kept) {
+    DIR *dir = opendir(directory);
+    if (!dir) {
+        return;
+    }
+    CacheFile *files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t totalBytes = 0;
+    struct dirent *item;
+    while ((item = readdir(dir)) != NULL) {
+        size_t length = strlen(item->d_name);
+        if (length < 16 || length >= sizeof(files->name) || strspn(item->d_name, "0123456789abcdef") < 16) {
+            continue;
+        }
+        char path[1024];
+        struct stat info;
+        if (snprintf(path, sizeof(path), "%s/%s", directory, item->d_name) >= (int)sizeof(path) ||
+            stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity < 64 ? 64 : capacity * 2;
+            files = (CacheFile *)checkedRealloc(files, capacity * sizeof(CacheFile));
+        }
+        memcpy(files[count].name, item->d_name, length + 1);
+        files[count].modified = info.st_mtime;
+        files[count].size = info.st_size;
+        totalBytes += (size_t)info.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (count > AST_CACHE_MAX_ENTRIES || totalBytes > AST_CACHE_MAX_BYTES) {
+        qsort(files, count, sizeof(CacheFile), compareCacheFiles);
+        size_t remaining = count;
+        for (size_t i = 0; i < count && (remaining > AST_CACHE_MAX_ENTRIES || totalBytes > AST_CACHE_MAX_BYTES); i++) {
+            char path[1024];
+            if (strcmp(files[i].name, kept) == 0 ||
+                snprintf(path, sizeof(path), "%s/%s", directory, files[i].name) >= (int)sizeof(path)) {
+                continue;
+            }
+            if (remove(path) == 0) {
+                remaining--;
+                totalBytes -= (size_t)files[i].size;
+            }
+        }
+    }
+    free(files);
+}
+#endif
+
+int loadAstCache(const char *directory, const char *source, size_t sourceLength, FlatAst *ast) {
+#ifndef _WIN32
+    uint64_t sourceHash = hashBytes(source, sourceLength);
+    char path[1024];
+    if (!cachePath(path, sizeof(path), directory, sourceHash, "")) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || (size_t)info.st_size < sizeof(AstCacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    size_t length = (size_t)info.st_size;
+    void *mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return 0;
+    }
+
+    const AstCacheHeader *header = (const AstCacheHeader *)mapping;
+    AstCacheHeader expected;
+    fillCacheHeader(&expected, sourceHash, sourceLength);
+    if (!validCacheEntry(header, &expected, source, length)) {
+        munmap(mapping, length);
+        return 0;
+    }
+    utimensat(AT_FDCWD, path, NULL, 0);    // the modification time orders entries for eviction
+
+    size_t nodeCount = (size_t)header->nodeCount;
+    size_t statementCount = (size_t)header->statementCount;
+    AstOperand *operands = (AstOperand *)(header + 1);
+    AstIndex *statements = (AstIndex *)(operands + nodeCount);
+    uint8_t *opcodes = (uint8_t *)(statements + statementCount);
+    const char *name = (const char *)(opcodes + nodeCount);
+    // In a fresh process the names intern to the IDs they were saved with; otherwise the
+    // arrays are copied out of the mapping and the identifiers renumbered
+    SymbolId *symbols = (SymbolId *)malloc((header->symbolCount + 1) * sizeof(SymbolId));
+    if (!symbols) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    int renumber = 0;
+    for (uint32_t i = 0; i < header->symbolCount; i++) {
+        size_t nameLength = strlen(name);
+        symbols[i] = internSymbol(name, nameLength);
+        renumber |= symbols[i] != (SymbolId)i;
+        name += nameLength + 1;
+    }
+
+    ast->size = header->nodeCount;
+    ast->statementCount = header->statementCount;
+    ast->root = header->root;
+    if (!renumber) {
+        ast->opcodes = opcodes;
+        ast->operands = operands;
+        ast->statements = statements;
+        ast->mapping = mapping;
+        ast->mappingLength = length;
+    } else {
+        ast->opcodes = (uint8_t *)malloc(nodeCount + 1);
+        ast->operands = (AstOperand *)malloc((nodeCount + 1) * sizeof(AstOperand));
+        ast->statements = (AstIndex *)malloc((statementCount + 1) * sizeof(AstIndex));
+        if (!ast->opcodes || !ast->operands || !ast->statements) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(ast->opcodes, opcodes, nodeCount);
+        memcpy(ast->operands, operands, nodeCount * sizeof(AstOperand));
+        memcpy(ast->statements, statements, statementCount * sizeof(AstIndex));
+        for (size_t i = 0; i < nodeCount; i++) {
+            if (ast->opcodes[i] == TOKEN_IDENTIFIER && ast->operands[i].symbol != SYMBOL_NONE) {
+                ast->operands[i].symbol = symbols[ast->operands[i].symbol];
+            }
+        }
+        ast->mapping = NULL;
+        ast->mappingLength = 0;
+        munmap(mapping, length);
+    }
+    free(symbols);
+    return 1;
+#else
+    (void)directory;
+    (void)source;
+    (void)sourceLength;
+    (void)ast;
+    return 0;
+#endif
+}
+
+int writeAstCache(const char *directory, const char *source, size_t sourceLength, const FlatAst *ast) {
+#ifndef _WIN32
+    uint64_t sourceHash = hashBytes(source, sourceLength);
+    char path[1024];
+    char temporaryPath[1024];
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%ld.tmp", (long)getpid());
+    if (!cachePath(path, sizeof(path), directory, sourceHash, "") ||
+        !cachePath(temporaryPath, sizeof(temporaryPath), directory, sourceHash, suffix)) {
+        return 0;
+    }
+    mkdir(directory, 0777); // an existing directory is fine; any other failure shows up below
+
+    AstCacheHeader header;
+    fillCacheHeader(&header, sourceHash, sourceLength);
+    header.nodeCount = ast->size;
+    header.root = ast->root;
+    header.statementCount = ast->statementCount;
+    header.symbolCount = (uint32_t)symbolCount();
+    size_t nameBytes = 0;
+    for (uint32_t i = 0; i < header.symbolCount; i++) {
+        nameBytes += strlen(symbolName((SymbolId)i)) + 1;
+    }
+    if (nameBytes > UINT32_MAX) {
+        return 0;
+    }
+    header.nameBytes = (uint32_t)nameBytes;
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (!file) {
+        return 0;
+    }
+    size_t nodeCount = (size_t)ast->size;
+    size_t statementCount = (size_t)ast->statementCount;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(ast->operands, sizeof(AstOperand), nodeCount, file) == nodeCount &&
+             fwrite(ast->statements, sizeof(AstIndex), statementCount, file) == statementCount &&
+             fwrite(ast->opcodes, 1, nodeCount, file) == nodeCount;
+    for (uint32_t i = 0; ok && i < header.symbolCount; i++) {
+        const char *name = symbolName((SymbolId)i);
+        ok = fwrite(name, 1, strlen(name) + 1, file) == strlen(name) + 1;
+    }
+    ok = ok && fwrite(source, 1, sourceLength, file) == sourceLength;
+    ok = fclose(file) == 0 && ok;
+    // Readers only ever see a complete entry: it appears under its name in one rename
+    if (!ok || rename(temporaryPath, path) != 0) {
+        remove(temporaryPath);
+        return 0;
+    }
+    pruneAstCache(directory, path + strlen(directory) + 1);
+    return 1;
+#else
+    (void)directory;
+    (void)source;
+    (void)sourceLength;
+    (void)ast;
+    return 0;
+#endif
+}
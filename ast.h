@@ -0,0 +1,73 @@
+// ast.h
+#ifndef AST_H
+#define AST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intern.h"
+#include "parser.h"
+
+// Flat form of the tree for the interpreter and later passes. Nodes live in two parallel
+// arrays indexed by AstIndex: a one-byte opcode (the TokenType) and an 8-byte operand that
+// holds, as for Node, a literal value, a symbol, the indexes of the two children, or for a
+// block the range of its statements in a third array.
+//
+// Nodes are emitted in execution order: the children of a node come before it, in the
+// order the interpreter visits them (the statements of a block in turn, a condition before
+// its body, operands before their operator, a divisor before its dividend), so a walk moves
+// mostly forward and an expression is a contiguous run of nodes ending at its root.
+typedef int32_t AstIndex;
+
+#define AST_NONE (-1)
+
+typedef union {
+    struct {
+        AstIndex left;
+        AstIndex right;
+    };
+    struct {                // TOKEN_NEW_LINE: statements[first .. first + count)
+        AstIndex first;
+        AstIndex count;
+    };
+    int intValue;           // TOKEN_INT_LITERAL
+    double doubleValue;     // TOKEN_DOUBLE_LITERAL
+    SymbolId symbol;        // TOKEN_IDENTIFIER
+} AstOperand;
+
+typedef struct {
+    uint8_t *opcodes;
+    AstOperand *operands;
+    AstIndex size;
+    AstIndex *statements;   // the statements of every block, each block's in one run
+    AstIndex statementCount;
+    AstIndex root;          // AST_NONE for an empty program
+    void *mapping;          // set when the arrays point into a mapped cache entry
+    size_t mappingLength;
+} FlatAst;
+
+// Flatten the pointer tree at root; the Node tree can be freed afterwards
+void flattenAst(const Node *root, FlatAst *ast);
+
+void freeFlatAst(FlatAst *ast);
+
+// On-disk cache of flattened programs, one file per source named by the source's hash.
+// An entry holds the operand and opcode arrays exactly as they are in memory, followed by
+// the names of the symbols, so a warm start maps the file and interns the names; nothing
+// is lexed or parsed. Each entry records the compiler build that wrote it and a copy of the
+// source, which must match byte for byte: the hash only picks the file.
+#define AST_CACHE_DIRECTORY ".iwcache"
+// Bounds on the directory: a write that takes it past either one evicts the least recently
+// used entries, including those of sources that were edited since and can never hit again
+#define AST_CACHE_MAX_ENTRIES 256
+#define AST_CACHE_MAX_BYTES (64u << 20)
+
+// Load the entry for this source into *ast, mapped rather than copied, and mark it used.
+// Returns 0 on a miss: no entry, a damaged one, one from another compiler build or one for
+// another source.
+int loadAstCache(const char *directory, const char *source, size_t sourceLength, FlatAst *ast);
+
+// Store ast as the entry for the source, creating directory if needed, then evict entries
+// until the directory is within its bounds; returns 0 if the entry could not be written
+int writeAstCache(const char *directory, const char *source, size_t sourceLength, const FlatAst *ast);
+
+#endif // AST_H
@@ -0,0 +1,210 @@
+// bench_lexer.c - lexer throughput on generated programs.
+//
+// Usage: bench_lexer [--min SIZE] [--max SIZE] [--seed N] [--threads N]
+//        bench_lexer --generate SIZE FILE
+// Sizes take K, M and G suffixes (powers of 1000). The benchmark runs sizes from --min (default 1K) to
+// --max (default 100M) in steps of 10x and reports MB/s and tokens/s for tokenize() alone,
+// for performLexicalAnalysis() end to end, which loads the file from disk and lexes it on
+// lexerThreadCount threads (--threads, default one per online processor; 1 lexes
+// sequentially), and for the stream lexer reading the file through a STREAM_LEXER_WINDOW
+// window. --generate only writes a program.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "charscan.h"
+#include "lexer.h"
+#include "programgen.h"
+
+#define BENCH_INPUT_FILE "bench_lexer_input.iw"
+// Each measurement repeats until this much time has passed, and keeps the best run. A
+// warm-up run goes first, so the program's names are already interned when timing starts.
+#define BENCH_MIN_SECONDS 0.5
+
+static double now(void) {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static int writeFile(const char *filename, const char *data, size_t length) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        perror("Could not open output file");
+        return 0;
+    }
+    int ok = fwrite(data, 1, length, file) == length;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        perror("Could not write output file");
+    }
+    return ok;
+}
+
+typedef struct {
+    double seconds;       // best run
+    size_t tokens;
+} Measurement;
+
+static Measurement measureTokenize(const char *source, size_t length) {
+    Measurement best = {0, 0};
+    double spent = 0;
+    TokenList warmUp = tokenize(source, length);
+    freeTokenList(&warmUp);
+    do {
+        double start = now();
+        TokenList tokenList = tokenize(source, length);
+        double seconds = now() - start;
+        best.tokens = tokenList.size;
+        freeTokenList(&tokenList);
+        if (best.seconds == 0 || seconds < best.seconds) {
+            best.seconds = seconds;
+        }
+        spent += seconds;
+    } while (spent < BENCH_MIN_SECONDS);
+    return best;
+}
+
+static Measurement measureEndToEnd(const char *filename) {
+    Measurement best = {0, 0};
+    double spent = 0;
+    do {
+        double start = now();
+        TokenList tokenList = performLexicalAnalysis(filename, NULL);
+        double seconds = now() - start;
+        best.tokens = tokenList.size;
+        freeTokenList(&tokenList);
+        if (best.seconds == 0 || seconds < best.seconds) {
+            best.seconds = seconds;
+        }
+        spent += seconds;
+    } while (spent < BENCH_MIN_SECONDS);
+    return best;
+}
+
+// Tokens the stream lexer hands out per call, as IW --check --stream takes them
+#define BENCH_STREAM_BATCH 1024
+
+static Measurement measureStream(const char *filename) {
+    static Token tokens[BENCH_STREAM_BATCH];
+    Measurement best = {0, 0};
+    double spent = 0;
+    do {
+        double start = now();
+        StreamLexer lexer;
+        if (!streamLexerOpen(&lexer, filename, STREAM_LEXER_WINDOW)) {
+            exit(EXIT_FAILURE);
+        }
+        size_t total = 0;
+        size_t count;
+        while ((count = streamLexerNextBatch(&lexer, tokens, BENCH_STREAM_BATCH)) > 0) {
+            total += count;
+        }
+        streamLexerClose(&lexer);
+        double seconds = now() - start;
+        best.tokens = total;
+        if (best.seconds == 0 || seconds < best.seconds) {
+            best.seconds = seconds;
+        }
+        spent += seconds;
+    } while (spent < BENCH_MIN_SECONDS);
+    return best;
+}
+
+static void printRate(size_t bytes, Measurement measurement) {
+    double seconds = measurement.seconds > 0 ? measurement.seconds : 1e-9;
+    printf("  %10.1f %10.2f", (double)bytes / 1e6 / seconds, (double)measurement.tokens / 1e6 / seconds);
+}
+
+static void formatSize(char *buffer, size_t bufferSize, size_t bytes) {
+    static const char suffixes[] = "KMG";
+    int scale = -1;
+    while (scale < 2 && bytes >= 1000 && bytes % 1000 == 0) {
+        bytes /= 1000;
+        scale++;
+    }
+    if (scale < 0) {
+        snprintf(buffer, bufferSize, "%zu", bytes);
+    } else {
+        snprintf(buffer, bufferSize, "%zu%c", bytes, suffixes[scale]);
+    }
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: bench_lexer [--min SIZE] [--max SIZE] [--seed N] [--threads N]\n"
+                    "       bench_lexer --generate SIZE FILE\n");
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    size_t minSize = 1000;
+    size_t maxSize = (size_t)100 * 1000 * 1000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--generate") == 0 && i + 2 < argc) {
+            size_t size = parseSize(argv[i + 1]);
+            if (size == 0) {
+                return usage();
+            }
+            size_t length;
+            char *program = generateProgram(size, seed, &length);
+            int ok = writeFile(argv[i + 2], program, length);
+            free(program);
+            return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc) {
+            minSize = parseSize(argv[++i]);
+        } else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            maxSize = parseSize(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char *endOfNumber;
+            long threads = strtol(argv[++i], &endOfNumber, 10);
+            if (*endOfNumber != '\0' || threads < 1 || threads > 1024) {
+                return usage();
+            }
+            lexerThreadCount = (int)threads;
+        } else {
+            return usage();
+        }
+    }
+    if (minSize == 0 || maxSize < minSize) {
+        return usage();
+    }
+
+    int threads = lexerThreadCount > 0 ? lexerThreadCount : onlineProcessorCount();
+    printf("charscan kernels: %s, end-to-end threads: %d\n", charScanKernelName(), threads);
+    printf("%8s %12s  %10s %10s  %10s %10s  %10s %10s\n", "", "", "tokenize", "", "end to end", "", "stream", "");
+    printf("%8s %12s  %10s %10s  %10s %10s  %10s %10s\n", "size", "tokens", "MB/s", "Mtok/s", "MB/s", "Mtok/s",
+           "MB/s", "Mtok/s");
+
+    for (size_t size = minSize; size <= maxSize; size *= 10) {
+        size_t length;
+        char *program = generateProgram(size, seed, &length);
+        if (!writeFile(BENCH_INPUT_FILE, program, length)) {
+            free(program);
+            return EXIT_FAILURE;
+        }
+
+        Measurement alone = measureTokenize(program, length);
+        Measurement endToEnd = measureEndToEnd(BENCH_INPUT_FILE);
+        Measurement stream = measureStream(BENCH_INPUT_FILE);
+
+        char label[32];
+        formatSize(label, sizeof(label), size);
+        printf("%8s %12zu", label, alone.tokens);
+        printRate(length, alone);
+        printRate(length, endToEnd);
+        printRate(length, stream);
+        printf("\n");
+        fflush(stdout);
+
+        free(program);
+        remove(BENCH_INPUT_FILE);
+        if (size > maxSize / 10) {
+            break;
+        }
+    }
+    return EXIT_SUCCESS;
+}
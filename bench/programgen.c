@@ -0,0 +1,131 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "programgen.h"
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    unsigned state;       // xorshift32; never 0
+} Generator;
+
+static unsigned nextRandom(Generator *generator) {
+    unsigned x = generator->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    generator->state = x;
+    return x;
+}
+
+static void append(Generator *generator, const char *format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (generator->length + (size_t)length + 1 > generator->capacity) {
+        generator->capacity = (generator->length + (size_t)length + 1) * 2;
+        generator->data = (char *)realloc(generator->data, generator->capacity);
+        if (!generator->data) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(generator->data + generator->length, line, (size_t)length + 1);
+    generator->length += (size_t)length;
+}
+
+// An operand: one of the block's variables or a literal
+static void appendOperand(Generator *generator, unsigned block) {
+    switch (nextRandom(generator) % 4) {
+        case 0: append(generator, "i%u", block); break;
+        case 1: append(generator, "d%u", block); break;
+        case 2: append(generator, "%u", 1 + nextRandom(generator) % 999); break;
+        default: append(generator, "%u.%u", nextRandom(generator) % 100, nextRandom(generator) % 1000); break;
+    }
+}
+
+// A left-to-right chain of 1-4 operands, sometimes with a parenthesised pair. The first
+// operand is never parenthesised: the lexer wants a name or number right after '='.
+static void appendExpression(Generator *generator, unsigned block) {
+    static const char operators[] = "+-*/";
+    unsigned terms = 1 + nextRandom(generator) % 4;
+    for (unsigned i = 0; i < terms; i++) {
+        if (i > 0) {
+            append(generator, " %c ", operators[nextRandom(generator) % 4]);
+        }
+        if (i > 0 && nextRandom(generator) % 5 == 0) {
+            append(generator, "(");
+            appendOperand(generator, block);
+            append(generator, " %c ", operators[nextRandom(generator) % 4]);
+            appendOperand(generator, block);
+            append(generator, ")");
+        } else {
+            appendOperand(generator, block);
+        }
+    }
+}
+
+// One block declares two variables of its own and uses them in a few statements
+static void appendBlock(Generator *generator, unsigned block) {
+    append(generator, "#i i%u\n#d d%u\n", block, block);
+    append(generator, "i%u = %u\n", block, nextRandom(generator) % 100);
+    append(generator, "d%u = ", block);
+    appendExpression(generator, block);
+    append(generator, "\n");
+
+    switch (nextRandom(generator) % 3) {
+        case 0:
+            append(generator, "while (i%u < %u) {\n", block, 100 + nextRandom(generator) % 100);
+            append(generator, "i%u = i%u + 1\nd%u = ", block, block, block);
+            appendExpression(generator, block);
+            append(generator, "\n}\n");
+            break;
+        case 1:
+            append(generator, "if (i%u == %u) {\nprint ", block, nextRandom(generator) % 100);
+            appendExpression(generator, block);
+            append(generator, "\n}\n");
+            break;
+        default:
+            append(generator, "print ");
+            appendExpression(generator, block);
+            append(generator, "\n");
+            break;
+    }
+}
+
+char *generateProgram(size_t targetBytes, unsigned seed, size_t *length) {
+    Generator generator = {NULL, 0, 0, seed ? seed : 1};
+    generator.capacity = targetBytes + 512;
+    generator.data = (char *)malloc(generator.capacity);
+    if (!generator.data) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    generator.data[0] = '\0';
+
+    for (unsigned block = 0; generator.length + 4 < targetBytes; block++) {
+        appendBlock(&generator, block);
+    }
+    append(&generator, "end\n");
+    *length = generator.length;
+    return generator.data;
+}
+
+size_t parseSize(const char *text) {
+    char *suffix;
+    unsigned long long value = strtoull(text, &suffix, 10);
+    if (suffix == text) {
+        return 0;
+    }
+    switch (*suffix) {
+        case 'K': case 'k': value *= 1000; suffix++; break;
+        case 'M': case 'm': value *= 1000 * 1000; suffix++; break;
+        case 'G': case 'g': value *= 1000 * 1000 * 1000; suffix++; break;
+    }
+    return *suffix == '\0' ? (size_t)value : 0;
+}
@@ -0,0 +1,16 @@
+// programgen.h
+#ifndef PROGRAMGEN_H
+#define PROGRAMGEN_H
+
+#include <stddef.h>
+
+// Generate a synthetic program of about targetBytes bytes (never less) that mixes
+// declarations, assignments with arithmetic, while and if blocks, and prints, and ends
+// with "end". The same seed gives the same program. The result is NUL-terminated and
+// must be freed; *length receives its length.
+char *generateProgram(size_t targetBytes, unsigned seed, size_t *length);
+
+// Parse a size such as "4096", "64K", "10M" or "1G" (powers of 1000, as MB/s is); returns 0 if invalid
+size_t parseSize(const char *text);
+
+#endif // PROGRAMGEN_H
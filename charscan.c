@@ -0,0 +1,198 @@
+#include <string.h>
+#include "charscan.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CHARSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+const unsigned char charClassTable[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 4, 4, 4, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+        0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 8,
+        0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static size_t scalarRun(const char *p, const char *end, unsigned char classes) {
+    const char *start = p;
+    while (p < end && charIs(*p, classes)) p++;
+    return (size_t)(p - start);
+}
+
+static size_t scalarIdentifierRun(const char *p, const char *end) {
+    return scalarRun(p, end, CHAR_IDENTIFIER);
+}
+
+static size_t scalarDigitRun(const char *p, const char *end) {
+    return scalarRun(p, end, CHAR_DIGIT);
+}
+
+static size_t scalarSpaceRun(const char *p, const char *end) {
+    return scalarRun(p, end, CHAR_SPACE);
+}
+
+#ifdef CHARSCAN_X86
+
+// The vector kernels build a mask of the bytes that belong to the class, 16 or 32 at a
+// time, and stop at the first lane outside it. Bytes >= 0x80 are negative in the signed
+// compares and so never fall inside a range. The tail shorter than a vector is scalar.
+
+__attribute__((target("sse2")))
+static __m128i sse2InRange(__m128i bytes, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8((char)(low - 1))),
+                         _mm_cmplt_epi8(bytes, _mm_set1_epi8((char)(high + 1))));
+}
+
+__attribute__((target("sse2")))
+static __m128i sse2Digits(__m128i bytes) {
+    return sse2InRange(bytes, '0', '9');
+}
+
+__attribute__((target("sse2")))
+static __m128i sse2Identifier(__m128i bytes) {
+    __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+    __m128i letters = sse2InRange(lower, 'a', 'z');
+    __m128i underscore = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letters, underscore), sse2Digits(bytes));
+}
+
+__attribute__((target("sse2")))
+static __m128i sse2Space(__m128i bytes) {
+    // '\t' '\v' '\f' '\r' are 9..13 without '\n' (10), plus ' '
+    __m128i controls = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), sse2InRange(bytes, '\t', '\r'));
+    return _mm_or_si128(controls, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+}
+
+#define SSE2_RUN(name, classify, classes)                                                 \
+    __attribute__((target("sse2")))                                                       \
+    static size_t name(const char *p, const char *end) {                                  \
+        const char *start = p;                                                            \
+        while (end - p >= 16) {                                                           \
+            __m128i bytes = _mm_loadu_si128((const __m128i *)p);                           \
+            unsigned outside = ~(unsigned)_mm_movemask_epi8(classify(bytes)) & 0xFFFFu;   \
+            if (outside != 0) {                                                           \
+                return (size_t)(p - start) + (size_t)__builtin_ctz(outside);              \
+            }                                                                             \
+            p += 16;                                                                      \
+        }                                                                                 \
+        return (size_t)(p - start) + scalarRun(p, end, classes);                          \
+    }
+
+SSE2_RUN(sse2IdentifierRun, sse2Identifier, CHAR_IDENTIFIER)
+SSE2_RUN(sse2DigitRun, sse2Digits, CHAR_DIGIT)
+SSE2_RUN(sse2SpaceRun, sse2Space, CHAR_SPACE)
+
+__attribute__((target("avx2")))
+static __m256i avx2InRange(__m256i bytes, char low, char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8((char)(low - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(high + 1)), bytes));
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2Digits(__m256i bytes) {
+    return avx2InRange(bytes, '0', '9');
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2Identifier(__m256i bytes) {
+    __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+    __m256i letters = avx2InRange(lower, 'a', 'z');
+    __m256i underscore = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(letters, underscore), avx2Digits(bytes));
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2Space(__m256i bytes) {
+    __m256i controls = _mm256_andnot_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')), avx2InRange(bytes, '\t', '\r'));
+    return _mm256_or_si256(controls, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')));
+}
+
+#define AVX2_RUN(name, classify, tail)                                                    \
+    __attribute__((target("avx2")))                                                       \
+    static size_t name(const char *p, const char *end) {                                  \
+        const char *start = p;                                                            \
+        while (end - p >= 32) {                                                           \
+            __m256i bytes = _mm256_loadu_si256((const __m256i *)p);                        \
+            unsigned outside = ~(unsigned)_mm256_movemask_epi8(classify(bytes));          \
+            if (outside != 0) {                                                           \
+                return (size_t)(p - start) + (size_t)__builtin_ctz(outside);              \
+            }                                                                             \
+            p += 32;                                                                      \
+        }                                                                                 \
+        return (size_t)(p - start) + tail(p, end);                                        \
+    }
+
+AVX2_RUN(avx2IdentifierRun, avx2Identifier, sse2IdentifierRun)
+AVX2_RUN(avx2DigitRun, avx2Digits, sse2DigitRun)
+AVX2_RUN(avx2SpaceRun, avx2Space, sse2SpaceRun)
+
+#endif // CHARSCAN_X86
+
+typedef struct {
+    const char *name;
+    size_t (*identifierRun)(const char *p, const char *end);
+    size_t (*digitRun)(const char *p, const char *end);
+    size_t (*spaceRun)(const char *p, const char *end);
+} CharScanKernels;
+
+// Scalar until the load-time CPU check below picks something better
+static CharScanKernels kernels = {"scalar", scalarIdentifierRun, scalarDigitRun, scalarSpaceRun};
+
+int useCharScanKernels(const char *name) {
+    if (strcmp(name, "scalar") == 0) {
+        CharScanKernels scalar = {"scalar", scalarIdentifierRun, scalarDigitRun, scalarSpaceRun};
+        kernels = scalar;
+        return 1;
+    }
+#ifdef CHARSCAN_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        CharScanKernels avx2 = {"avx2", avx2IdentifierRun, avx2DigitRun, avx2SpaceRun};
+        kernels = avx2;
+        return 1;
+    } else if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        CharScanKernels sse2 = {"sse2", sse2IdentifierRun, sse2DigitRun, sse2SpaceRun};
+        kernels = sse2;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+#ifdef CHARSCAN_X86
+// Runs before main(), so the lexer threads only ever read the chosen kernels
+__attribute__((constructor))
+static void selectCharScanKernels(void) {
+    if (!useCharScanKernels("avx2")) {
+        useCharScanKernels("sse2");
+    }
+}
+#endif
+
+size_t scanIdentifierRun(const char *p, const char *end) {
+    return kernels.identifierRun(p, end);
+}
+
+size_t scanDigitRun(const char *p, const char *end) {
+    return kernels.digitRun(p, end);
+}
+
+size_t scanSpaceRun(const char *p, const char *end) {
+    return kernels.spaceRun(p, end);
+}
+
+const char *charScanKernelName(void) {
+    return kernels.name;
+}
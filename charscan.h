@@ -0,0 +1,37 @@
+// charscan.h
+#ifndef CHARSCAN_H
+#define CHARSCAN_H
+
+#include <stddef.h>
+
+// ASCII character classes used by the lexer. Unlike <ctype.h> they do not depend on the locale.
+enum {
+    CHAR_DIGIT = 1,       // 0-9
+    CHAR_ALPHA = 2,       // A-Z a-z
+    CHAR_SPACE = 4,       // blanks other than '\n', which is a token of its own
+    CHAR_UNDERSCORE = 8,
+    CHAR_IDENTIFIER = CHAR_DIGIT | CHAR_ALPHA | CHAR_UNDERSCORE
+};
+
+extern const unsigned char charClassTable[256];
+
+#define charIs(c, classes) (charClassTable[(unsigned char)(c)] & (classes))
+
+// Length of the run of identifier characters (letters, digits, '_') starting at p
+size_t scanIdentifierRun(const char *p, const char *end);
+
+// Length of the run of decimal digits starting at p
+size_t scanDigitRun(const char *p, const char *end);
+
+// Length of the run of blanks (not counting '\n') starting at p
+size_t scanSpaceRun(const char *p, const char *end);
+
+// Name of the kernel set picked for this CPU: "avx2", "sse2" or "scalar"
+const char *charScanKernelName(void);
+
+// Switch to the named kernel set; returns 0, changing nothing, when this CPU or build cannot
+// run it. The best one is picked at load time, so only checks and benchmarks need this, and
+// it must not be called while another thread is lexing.
+int useCharScanKernels(const char *name);
+
+#endif // CHARSCAN_H
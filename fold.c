@@ -0,0 +1,203 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fold.h"
+#include "intern.h"
+
+// What the program has declared each symbol as so far, going through its statements in order
+#define SYMBOL_UNDECLARED 0
+#define SYMBOL_INT 1
+#define SYMBOL_OTHER 2
+
+// A node whose children are being folded. slot is where its parent points at it, so it can
+// be replaced by a simpler node.
+typedef struct {
+    Node **slot;
+    int visited;                // children done so far
+    int impureChildren;         // set when a child is not a pure expression
+} FoldFrame;
+
+typedef struct {
+    FoldFrame *stack;
+    size_t depth;
+    size_t capacity;
+    const uint8_t *declared;    // SYMBOL_INT etc. for each symbol, as of the statement being folded
+} Folder;
+
+static int isLiteral(const Node *node) {
+    return node->type == TOKEN_INT_LITERAL || node->type == TOKEN_DOUBLE_LITERAL;
+}
+
+static int isOperator(TokenType type) {
+    return type == TOKEN_PLUS || type == TOKEN_MINUS || type == TOKEN_MULTI || type == TOKEN_DIVISION ||
+           type == TOKEN_GREATER || type == TOKEN_LESS || type == TOKEN_EQUAL;
+}
+
+// Literals hold what they were written as; the interpreter reads them as floats
+static float literalValue(const Node *node) {
+    return node->type == TOKEN_INT_LITERAL ? (float)node->intValue : (float)node->doubleValue;
+}
+
+static int isLiteralValue(const Node *node, float value) {
+    return isLiteral(node) && literalValue(node) == value;
+}
+
+// Stored as a double, which holds any float exactly
+static void makeLiteral(Node *node, float value) {
+    node->type = (uint8_t)TOKEN_DOUBLE_LITERAL;
+    node->doubleValue = value;
+}
+
+static float applyOperator(TokenType type, float left, float right) {
+    switch (type) {
+        case TOKEN_PLUS:
+            return left + right;
+        case TOKEN_MINUS:
+            return left - right;
+        case TOKEN_MULTI:
+            return left * right;
+        case TOKEN_DIVISION:
+            return left / right;
+        case TOKEN_GREATER:
+            return left > right;
+        case TOKEN_LESS:
+            return left < right;
+        case TOKEN_EQUAL:
+            return left == right;
+        default:
+            return 0;
+    }
+}
+
+// A divisor that is a power of two has an exact reciprocal, and multiplying by it rounds to
+// the same float as dividing
+static int exactReciprocal(float divisor, float *reciprocal) {
+    int exponent;
+    if (divisor == 0 || !isfinite(divisor) || fabsf(frexpf(divisor, &exponent)) != 0.5f) {
+        return 0;
+    }
+    *reciprocal = 1.0f / divisor;
+    return isfinite(*reciprocal) && *reciprocal * divisor == 1.0f;
+}
+
+// Holds an int on every run: a name the program declared int in an earlier statement. A
+// name used before its declaration is left alone, so the error for it is still raised.
+static int isIntVariable(const Folder *folder, const Node *node) {
+    return node->type == TOKEN_IDENTIFIER && node->symbol >= 0 && (size_t)node->symbol < symbolCount() &&
+           folder->declared[node->symbol] == SYMBOL_INT;
+}
+
+// Simplified form of an operator over two pure expressions
+static Node* simplify(const Folder *folder, Node *node) {
+    TokenType type = (TokenType)node->type;
+    Node *left = node->left;
+    Node *right = node->right;
+    if (isLiteral(left) && isLiteral(right)) {
+        // A division by zero is left to raise its error if and when it runs
+        if (type != TOKEN_DIVISION || literalValue(right) != 0) {
+            makeLiteral(node, applyOperator(type, literalValue(left), literalValue(right)));
+        }
+        return node;
+    }
+
+    float reciprocal;
+    if (type == TOKEN_DIVISION && isLiteral(right) && exactReciprocal(literalValue(right), &reciprocal)) {
+        type = TOKEN_MULTI;
+        node->type = (uint8_t)type;
+        makeLiteral(right, reciprocal);
+    }
+    if ((type == TOKEN_MULTI && isLiteralValue(right, 1)) ||
+        ((type == TOKEN_PLUS || type == TOKEN_MINUS) && isLiteralValue(right, 0))) {
+        return left;
+    } else if ((type == TOKEN_MULTI && isLiteralValue(left, 1)) || (type == TOKEN_PLUS && isLiteralValue(left, 0))) {
+        return right;
+    } else if (type == TOKEN_MULTI && ((isLiteralValue(right, 0) && isIntVariable(folder, left)) ||
+                                       (isLiteralValue(left, 0) && isIntVariable(folder, right)))) {
+        makeLiteral(node, 0);
+    }
+    return node;
+}
+
+static void pushFrame(Folder *folder, Node **slot) {
+    if (folder->depth == folder->capacity) {
+        folder->capacity = folder->capacity < 64 ? 64 : folder->capacity * 2;
+        FoldFrame *grown = (FoldFrame *)realloc(folder->stack, folder->capacity * sizeof(FoldFrame));
+        if (!grown) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        folder->stack = grown;
+    }
+    FoldFrame *frame = &folder->stack[folder->depth++];
+    frame->slot = slot;
+    frame->visited = 0;
+    frame->impureChildren = 0;
+}
+
+// Slot of child i of node, or NULL once there are no more; missing children are skipped
+static Node** childSlot(Node *node, int i) {
+    if (node->type == TOKEN_NEW_LINE) {
+        return i < node->statementCount ? &node->statements[i] : NULL;
+    } else if (node->type == TOKEN_IDENTIFIER || isLiteral(node) || i >= 2) {
+        return NULL;
+    }
+    return i == 0 ? &node->left : &node->right;
+}
+
+// Post-order walk with an explicit stack, as in flattenAst()
+static void foldTree(Folder *folder, Node **root) {
+    pushFrame(folder, root);
+    while (folder->depth > 0) {
+        FoldFrame *frame = &folder->stack[folder->depth - 1];
+        Node *node = *frame->slot;
+        Node **child = childSlot(node, frame->visited);
+        if (child) {
+            frame->visited++;
+            if (*child) {
+                pushFrame(folder, child);
+            } else {
+                frame->impureChildren = 1;
+            }
+            continue;
+        }
+
+        int pure = node->type == TOKEN_IDENTIFIER || isLiteral(node) ||
+                   (isOperator((TokenType)node->type) && !frame->impureChildren);
+        if (pure && isOperator((TokenType)node->type)) {
+            *frame->slot = simplify(folder, node);
+        }
+        folder->depth--;
+        if (folder->depth > 0 && !pure) {
+            folder->stack[folder->depth - 1].impureChildren = 1;
+        }
+    }
+}
+
+Node* foldConstants(Node *root) {
+    if (!root) {
+        return NULL;
+    }
+    uint8_t *declared = (uint8_t *)calloc(symbolCount() + 1, 1);
+    if (!declared) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    Folder folder = {NULL, 0, 0, declared};
+    if (root->type != TOKEN_NEW_LINE) {
+        foldTree(&folder, &root);
+    } else {
+        // The program's statements run once each, in order, and only they declare variables
+        for (int i = 0; i < root->statementCount; i++) {
+            foldTree(&folder, &root->statements[i]);
+            const Node *statement = root->statements[i];
+            const Node *name = statement->type == TOKEN_INT_DECL || statement->type == TOKEN_DOUBLE_DECL ? statement->right : NULL;
+            if (name && name->type == TOKEN_IDENTIFIER && name->symbol >= 0 && (size_t)name->symbol < symbolCount() &&
+                declared[name->symbol] == SYMBOL_UNDECLARED) {
+                declared[name->symbol] = statement->type == TOKEN_INT_DECL ? SYMBOL_INT : SYMBOL_OTHER;
+            }
+        }
+    }
+    free(folder.stack);
+    free(declared);
+    return root;
+}
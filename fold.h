@@ -0,0 +1,15 @@
+// fold.h
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "parser.h"
+
+// Simplify the parsed program in place before it is flattened: operators on two constants
+// become one constant, x * 1, x + 0 and x - 0 become x, x * 0 becomes 0 for an int variable
+// x, and a division by a power of two becomes a multiplication. Only expressions of
+// literals, names and operators are touched, and every rewrite gives the float result the
+// interpreter would compute and raises the same errors at the same points, including a
+// division by a constant zero. Returns the new root.
+Node* foldConstants(Node *root);
+
+#endif // FOLD_H
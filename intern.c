@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "intern.h"
+
+// Process-wide identifier table. Names are copied once into an arena; lookups go through
+// an open-addressing hash of IDs kept at most half full.
+typedef struct {
+    Arena text;
+    const char **names;    // indexed by SymbolId
+    size_t *lengths;
+    size_t count;
+    size_t capacity;
+    SymbolId *slots;       // SYMBOL_NONE when empty
+    size_t slotCount;      // power of two
+} Interner;
+
+static Interner interner;
+
+size_t hashBytes(const char *text, size_t length) {
+    size_t hash = 14695981039346656037ULL; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void *checkedRealloc(void *old, size_t size) {
+    void *result = realloc(old, size);
+    if (!result) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static void rehash(size_t slotCount) {
+    interner.slots = (SymbolId *)checkedRealloc(interner.slots, slotCount * sizeof(SymbolId));
+    interner.slotCount = slotCount;
+    for (size_t i = 0; i < slotCount; i++) {
+        interner.slots[i] = SYMBOL_NONE;
+    }
+    for (size_t symbol = 0; symbol < interner.count; symbol++) {
+        size_t slot = hashBytes(interner.names[symbol], interner.lengths[symbol]) & (slotCount - 1);
+        while (interner.slots[slot] != SYMBOL_NONE) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        interner.slots[slot] = (SymbolId)symbol;
+    }
+}
+
+SymbolId internSymbol(const char *name, size_t length) {
+    if (interner.slotCount == 0) {
+        arenaInit(&interner.text, 0);
+        rehash(256);
+    }
+    size_t mask = interner.slotCount - 1;
+    size_t slot = hashBytes(name, length) & mask;
+    SymbolId symbol;
+    while ((symbol = interner.slots[slot]) != SYMBOL_NONE) {
+        if (interner.lengths[symbol] == length && memcmp(interner.names[symbol], name, length) == 0) {
+            return symbol;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (interner.count == interner.capacity) {
+        interner.capacity = interner.capacity < 64 ? 64 : interner.capacity * 2;
+        interner.names = (const char **)checkedRealloc(interner.names, interner.capacity * sizeof(char *));
+        interner.lengths = (size_t *)checkedRealloc(interner.lengths, interner.capacity * sizeof(size_t));
+    }
+    char *copy = (char *)arenaAlloc(&interner.text, length + 1);
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    symbol = (SymbolId)interner.count++;
+    interner.names[symbol] = copy;
+    interner.lengths[symbol] = length;
+    interner.slots[slot] = symbol;
+    if (interner.count * 2 > interner.slotCount) {
+        rehash(interner.slotCount * 2);
+    }
+    return symbol;
+}
+
+const char *symbolName(SymbolId symbol) {
+    if (symbol < 0 || (size_t)symbol >= interner.count) {
+        return "";
+    }
+    return interner.names[symbol];
+}
+
+size_t symbolCount(void) {
+    return interner.count;
+}
@@ -0,0 +1,25 @@
+// intern.h
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// Dense ID of an interned identifier: the first distinct name is 0, the next 1, and so on.
+// IDs are only meaningful within one process.
+typedef int SymbolId;
+
+#define SYMBOL_NONE (-1)
+
+// Return the ID of name[0, length), adding it on first sight. Not thread-safe.
+SymbolId internSymbol(const char *name, size_t length);
+
+// NUL-terminated text of an interned name
+const char *symbolName(SymbolId symbol);
+
+// Number of names interned so far; every ID is below it
+size_t symbolCount(void);
+
+// 64-bit FNV-1a hash of a byte span
+size_t hashBytes(const char *text, size_t length);
+
+#endif // INTERN_H
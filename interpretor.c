@@ -1,203 +1,595 @@
-#include "parser.h"
-#include "lexer.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-
-int errorOccurred = 0;
-
-typedef struct variable{
-    char* name;
-    char* type;
-    int initialized;
-    union {
-        float f_val;
-        int i_val;
-    }value ;
-    struct variable* next;
-}variable ;
-
-variable *table = NULL;
-
-variable *find_or_add_variable(const char* name, int add_if_not_found, TokenType type){
-    variable *entry = table;
-    while (entry){
-        if (strcmp(entry->name, name) == 0){
-
-
-            return entry;
-        }
-        entry = entry->next;
-
-    }
-    if (add_if_not_found){
-        variable *new_entry = malloc(sizeof(variable));
-        new_entry->name = strdup(name);
-
-        new_entry->initialized = 0;
-
-        if (type == TOKEN_INT_DECL){
-            new_entry->value.i_val = 0;
-            new_entry->type = "int";
-        }
-        else if (type == TOKEN_DOUBLE_DECL){
-            new_entry->value.f_val = 0;
-            new_entry->type = "float";
-        }
-        new_entry->next = table;
-        table = new_entry;
-        return new_entry;
-    }
-    return NULL;
-}
-
-int is_whole_number(double value){
-    return value == floor(value);
-}
-
-void report_error(const char* message) {
-    fprintf(stderr, "Error: %s\n", message);
-}
-
-float interpret(Node* ast) {
-variable *entry;
-double left, right;
-if (!ast){
-    return 0;
-}
-    switch (ast->type) {
-        case TOKEN_NEW_LINE:
-            interpret(ast->right);
-//            printf("\n new line");
-            interpret(ast->left);
-            break;
-        case TOKEN_INT_DECL:
-        case TOKEN_DOUBLE_DECL:
-            entry = find_or_add_variable(ast->right->lexeme, 0, ast->type);
-            if (entry){
-                entry->initialized = 0;
-                char error_message[256];
-                snprintf(error_message, sizeof(error_message), "Variable '%s' already declared", ast->right->lexeme);
-                report_error(error_message);
-                exit(EXIT_FAILURE);
-            }
-            else {
-                entry = find_or_add_variable(ast->right->lexeme, 1, ast->type);
-                interpret(ast->left);
-                return 0;
-            }
-            break;
-        case TOKEN_IDENTIFIER:
-            entry = find_or_add_variable(ast->lexeme, 0, ast->type);
-            if (entry){
-                if (entry->type == "int"){
-                    return entry->value.i_val;
-                } else if (entry->type == "float"){
-                    return entry->value.f_val;
-                }
-            }
-            else{
-                char error_message[256];
-                snprintf(error_message, sizeof(error_message), "Variable '%s' not declared", ast->lexeme);
-                report_error(error_message);
-                exit(EXIT_FAILURE);
-                exit(EXIT_FAILURE);
-            }
-            break;
-
-        case TOKEN_INT_LITERAL:
-            return ast->intValue;
-        case TOKEN_DOUBLE_LITERAL:
-            return ast->doubleValue;
-
-        case TOKEN_PLUS:
-            return interpret(ast->left) + interpret(ast->right);
-        case TOKEN_MINUS:
-            return interpret(ast->left) - interpret(ast->right);
-        case TOKEN_MULTI:
-            return interpret(ast->left) * interpret(ast->right);
-        case TOKEN_DIVISION:
-            if (interpret(ast->right) == 0) {
-                report_error("Division by zero error");
-                exit(EXIT_FAILURE);
-            }
-            return interpret(ast->left) / interpret(ast->right);
-        case TOKEN_GREATER:
-            return interpret(ast->left) > interpret(ast->right);
-
-        case TOKEN_LESS:
-            return interpret(ast->left) < interpret(ast->right);
-
-        case TOKEN_EQUAL:
-            return interpret(ast->left) == interpret(ast->right);
-
-        case TOKEN_PRINT:
-            right = interpret(ast->right);
-            if (is_whole_number(right)) {
-                printf("%i \n", (int)right);
-            } else{
-                printf("%f \n", right);
-            }
-            interpret(ast->left);
-            break;
-
-        case TOKEN_ASSIGN:
-            entry = find_or_add_variable(ast->left->lexeme, 0, ast->type);
-            if (!entry) {
-                report_error("Variable not declared");
-                exit(EXIT_FAILURE); // Return an error code
-            }
-
-            errorOccurred = 0;  // Reset the error flag before interpretation
-            float right_value = interpret(ast->right);
-
-            // Check the type of the variable and assign the value
-            if (strcmp(entry->type, "int") == 0) {
-                if (is_whole_number(right_value)) {
-                    entry->value.i_val = (int)right_value;
-                    entry->initialized = 1;  // Mark as initialized
-                } else {
-                    // Type mismatch error
-                    report_error("Type mismatch: Cannot assign a non-integer value to integer variable");
-                    exit(EXIT_FAILURE);  // Return an error code
-                }
-            } else if (strcmp(entry->type, "float") == 0) {
-                entry->value.f_val = right_value;
-                entry->initialized = 1;  // Mark as initialized
-            } else {
-                // Unknown type error
-                report_error("Unknown type for variable");
-                exit(EXIT_FAILURE);  // Return an error code
-            }
-            break;
-
-        case TOKEN_IF:
-        if ((int) interpret(ast->left)){
-            interpret(ast->right);
-        }
-            interpret(ast->left);
-            break;
-        case TOKEN_WHILE:
-            while ((int) interpret(ast->left)){
-                interpret(ast->right);
-        }
-
-            interpret(ast->left);
-            break;
-
-}
-
-}
-
-
-int main() {
-    performLexicalAnalysis("./input.txt", "./output.json");
-    Node* root = Parser();  // Parse your language and get the AST
-    printf("\n");
-    interpret(root);
-    return 0;
-}
-
-
-
+#include "ast.h"
+#include "fold.h"
+#include "parser.h"
+#include "intern.h"
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+int errorOccurred = 0;
+
+typedef struct variable{
+    int declared;
+    TokenType type;     // TOKEN_INT_DECL or TOKEN_DOUBLE_DECL, as declared
+    int initialized;
+    union {
+        float f_val;
+        int i_val;
+    }value ;
+}variable ;
+
+// Variables are indexed by the interned symbol of their name
+variable *table = NULL;
+size_t tableSize = 0;
+
+variable *find_or_add_variable(SymbolId symbol, int add_if_not_found, TokenType type){
+    if (symbol < 0) {
+        return NULL;
+    }
+    if ((size_t)symbol >= tableSize) {
+        size_t newSize = symbolCount() > (size_t)symbol ? symbolCount() : (size_t)symbol + 1;
+        variable *grown = realloc(table, newSize * sizeof(variable));
+        if (!grown) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        memset(grown + tableSize, 0, (newSize - tableSize) * sizeof(variable));
+        table = grown;
+        tableSize = newSize;
+    }
+    variable *entry = &table[symbol];
+    if (entry->declared){
+        return entry;
+    }
+    if (add_if_not_found){
+        entry->declared = 1;
+        entry->initialized = 0;
+
+        entry->type = type;
+        if (type == TOKEN_INT_DECL){
+            entry->value.i_val = 0;
+        }
+        else if (type == TOKEN_DOUBLE_DECL){
+            entry->value.f_val = 0;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+// Symbol a declaration or assignment names; only identifier nodes carry one
+static SymbolId nodeSymbol(const FlatAst *tree, AstIndex index) {
+    return index != AST_NONE && tree->opcodes[index] == TOKEN_IDENTIFIER ? tree->operands[index].symbol : SYMBOL_NONE;
+}
+
+int is_whole_number(double value){
+    return value == floor(value);
+}
+
+void report_error(const char* message) {
+    fprintf(stderr, "Error: %s\n", message);
+}
+
+// A node being run: the interpreter keeps these on its own stack rather than the C stack,
+// so neither the length of a block nor the depth of an expression is limited by it
+typedef struct {
+    AstIndex index;
+    int step;               // children run so far, or statements run for a block
+    float saved;            // left operand, or right operand of a division
+} Frame;
+
+// A pure expression is a literal, a name, or an arithmetic or comparison operator over two
+// pure expressions. Its nodes are a contiguous run ending at its root, in the order they
+// are evaluated, so it runs as one forward scan over an operand stack with no frames.
+typedef struct {
+    const FlatAst *tree;
+    Frame *frames;
+    size_t depth;
+    size_t capacity;
+    AstIndex *expressionStart;  // first node of the pure expression rooted at each node, or AST_NONE
+    uint8_t *divisor;           // set on the root of each division's right operand
+    float *operands;            // operand stack of scanExpression()
+} Interpreter;
+
+static void *checkedMalloc(size_t size) {
+    void *result = malloc(size > 0 ? size : 1);
+    if (!result) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static void pushFrame(Interpreter *interpreter, AstIndex index) {
+    if (interpreter->depth == interpreter->capacity) {
+        interpreter->capacity = interpreter->capacity < 64 ? 64 : interpreter->capacity * 2;
+        Frame *grown = realloc(interpreter->frames, interpreter->capacity * sizeof(Frame));
+        if (!grown) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        interpreter->frames = grown;
+    }
+    Frame *frame = &interpreter->frames[interpreter->depth++];
+    frame->index = index;
+    frame->step = 0;
+}
+
+static int isOperator(TokenType type) {
+    return type == TOKEN_PLUS || type == TOKEN_MINUS || type == TOKEN_MULTI || type == TOKEN_DIVISION ||
+           type == TOKEN_GREATER || type == TOKEN_LESS || type == TOKEN_EQUAL;
+}
+
+// Find every pure expression: one pass, since children come before their parents. An
+// operator is only taken when its operands' runs sit back to back right before it, in the
+// order the flattener emits them.
+static void indexExpressions(Interpreter *interpreter) {
+    const FlatAst *tree = interpreter->tree;
+    size_t size = (size_t)tree->size;
+    interpreter->expressionStart = (AstIndex *)checkedMalloc(size * sizeof(AstIndex));
+    interpreter->divisor = (uint8_t *)checkedMalloc(size);
+    memset(interpreter->divisor, 0, size);
+    AstIndex longest = 0;
+    for (AstIndex i = 0; i < tree->size; i++) {
+        TokenType type = (TokenType)tree->opcodes[i];
+        const AstOperand *node = &tree->operands[i];
+        AstIndex start = AST_NONE;
+        if (type == TOKEN_INT_LITERAL || type == TOKEN_DOUBLE_LITERAL || type == TOKEN_IDENTIFIER) {
+            start = i;
+        } else if (isOperator(type) && node->left != AST_NONE && node->right != AST_NONE) {
+            AstIndex first = type == TOKEN_DIVISION ? node->right : node->left;
+            AstIndex second = type == TOKEN_DIVISION ? node->left : node->right;
+            AstIndex firstStart = interpreter->expressionStart[first];
+            AstIndex secondStart = interpreter->expressionStart[second];
+            if (firstStart != AST_NONE && secondStart == first + 1 && second == i - 1) {
+                start = firstStart;
+            }
+        }
+        if (type == TOKEN_DIVISION && node->right != AST_NONE) {
+            interpreter->divisor[node->right] = 1;
+        }
+        interpreter->expressionStart[i] = start;
+        if (start != AST_NONE && i - start + 1 > longest) {
+            longest = i - start + 1;
+        }
+    }
+    interpreter->operands = (float *)checkedMalloc((size_t)longest * sizeof(float));
+}
+
+static float binaryResult(TokenType type, float left, float right) {
+    switch (type) {
+        case TOKEN_PLUS:
+            return left + right;
+        case TOKEN_MINUS:
+            return left - right;
+        case TOKEN_MULTI:
+            return left * right;
+        case TOKEN_DIVISION:
+            return left / right;
+        case TOKEN_GREATER:
+            return left > right;
+        case TOKEN_LESS:
+            return left < right;
+        case TOKEN_EQUAL:
+            return left == right;
+        default:
+            return 0;
+    }
+}
+
+static float variableValue(SymbolId symbol) {
+    variable *entry = find_or_add_variable(symbol, 0, TOKEN_IDENTIFIER);
+    if (!entry) {
+        char error_message[256];
+        snprintf(error_message, sizeof(error_message), "Variable '%s' not declared", symbolName(symbol));
+        report_error(error_message);
+        exit(EXIT_FAILURE);
+    }
+    if (entry->type == TOKEN_INT_DECL){
+        return entry->value.i_val;
+    }
+    return entry->value.f_val;
+}
+
+// Value of the pure expression rooted at root. A division's divisor is checked as soon as
+// it is known, before the dividend is evaluated.
+static float scanExpression(const Interpreter *interpreter, AstIndex root) {
+    const FlatAst *tree = interpreter->tree;
+    float *top = interpreter->operands;
+    for (AstIndex i = interpreter->expressionStart[root]; i <= root; i++) {
+        TokenType type = (TokenType)tree->opcodes[i];
+        const AstOperand *node = &tree->operands[i];
+        if (type == TOKEN_INT_LITERAL) {
+            *top++ = node->intValue;
+        } else if (type == TOKEN_DOUBLE_LITERAL) {
+            *top++ = node->doubleValue;
+        } else if (type == TOKEN_IDENTIFIER) {
+            *top++ = variableValue(node->symbol);
+        } else if (type == TOKEN_DIVISION) {
+            top--;
+            top[-1] = binaryResult(type, top[0], top[-1]);
+        } else {
+            top--;
+            top[-1] = binaryResult(type, top[-1], top[0]);
+        }
+        if (interpreter->divisor[i] && top[-1] == 0) {
+            report_error("Division by zero error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return top[-1];
+}
+
+// Start running the child at index. A pure expression or a missing child is evaluated on
+// the spot into *result and 0 is returned; any other node is pushed, to be run by the loop
+// in interpret(), and 1 is returned.
+static int startChild(Interpreter *interpreter, AstIndex index, float *result) {
+    if (index == AST_NONE) {
+        *result = 0;
+        return 0;
+    } else if (interpreter->expressionStart[index] != AST_NONE) {
+        *result = scanExpression(interpreter, index);
+        return 0;
+    }
+    pushFrame(interpreter, index);
+    return 1;
+}
+
+// Run the node at index and return its value. Each pass of the loop resumes the node on top
+// of the stack at its step: it either starts its next child, going round again when that
+// child was pushed, or finishes with its value in result. A block starts its statements one
+// at a time. Operands run left to right, except that a division checks its divisor first.
+// Statements, error nodes and the end of input have no value of their own: an expression
+// reading one gets the last value computed.
+float interpret(const FlatAst *tree, AstIndex index) {
+Interpreter interpreter = {tree, NULL, 0, 0, NULL, NULL, NULL};
+indexExpressions(&interpreter);
+variable *entry;
+float result = 0;
+startChild(&interpreter, index, &result);
+while (interpreter.depth > 0) {
+    Frame *frame = &interpreter.frames[interpreter.depth - 1];
+    TokenType type = (TokenType)tree->opcodes[frame->index];
+    const AstOperand *node = &tree->operands[frame->index];
+    switch (type) {
+        case TOKEN_NEW_LINE: {
+            int pushed = 0;
+            while (!pushed && frame->step < node->count) {
+                pushed = startChild(&interpreter, tree->statements[node->first + frame->step++], &result);
+            }
+            if (pushed) {
+                continue;
+            }
+            break;
+        }
+        case TOKEN_INT_DECL:
+        case TOKEN_DOUBLE_DECL:
+            if (frame->step == 0) {
+                entry = find_or_add_variable(nodeSymbol(tree, node->right), 0, type);
+                if (entry){
+                    entry->initialized = 0;
+                    char error_message[256];
+                    snprintf(error_message, sizeof(error_message), "Variable '%s' already declared", symbolName(nodeSymbol(tree, node->right)));
+                    report_error(error_message);
+                    exit(EXIT_FAILURE);
+                }
+                find_or_add_variable(nodeSymbol(tree, node->right), 1, type);
+                frame->step = 1;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            result = 0;
+            break;
+
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:
+        case TOKEN_MULTI:
+        case TOKEN_GREATER:
+        case TOKEN_LESS:
+        case TOKEN_EQUAL:
+            if (frame->step == 0) {
+                frame->step = 1;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            if (frame->step == 1) {
+                frame->saved = result;
+                frame->step = 2;
+                if (startChild(&interpreter, node->right, &result)) {
+                    continue;
+                }
+            }
+            result = binaryResult(type, frame->saved, result);
+            break;
+        case TOKEN_DIVISION:
+            if (frame->step == 0) {
+                frame->step = 1;
+                if (startChild(&interpreter, node->right, &result)) {
+                    continue;
+                }
+            }
+            if (frame->step == 1) {
+                if (result == 0) {
+                    report_error("Division by zero error");
+                    exit(EXIT_FAILURE);
+                }
+                frame->saved = result;
+                frame->step = 2;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            result = binaryResult(type, result, frame->saved);
+            break;
+
+        case TOKEN_PRINT:
+            if (frame->step == 0) {
+                frame->step = 1;
+                if (startChild(&interpreter, node->right, &result)) {
+                    continue;
+                }
+            }
+            if (frame->step == 1) {
+                if (is_whole_number(result)) {
+                    printf("%i \n", (int)result);
+                } else{
+                    printf("%f \n", result);
+                }
+                frame->step = 2;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            break;
+
+        case TOKEN_ASSIGN:
+            if (frame->step == 0) {
+                if (!find_or_add_variable(nodeSymbol(tree, node->left), 0, type)) {
+                    report_error("Variable not declared");
+                    exit(EXIT_FAILURE); // Return an error code
+                }
+                errorOccurred = 0;  // Reset the error flag before interpretation
+                frame->step = 1;
+                if (startChild(&interpreter, node->right, &result)) {
+                    continue;
+                }
+            }
+            // Looked up again: reading the right side may have grown the table
+            entry = find_or_add_variable(nodeSymbol(tree, node->left), 0, type);
+
+            // Check the type of the variable and assign the value
+            if (entry->type == TOKEN_INT_DECL) {
+                if (is_whole_number(result)) {
+                    entry->value.i_val = (int)result;
+                    entry->initialized = 1;  // Mark as initialized
+                } else {
+                    // Type mismatch error
+                    report_error("Type mismatch: Cannot assign a non-integer value to integer variable");
+                    exit(EXIT_FAILURE);  // Return an error code
+                }
+            } else if (entry->type == TOKEN_DOUBLE_DECL) {
+                entry->value.f_val = result;
+                entry->initialized = 1;  // Mark as initialized
+            } else {
+                // Unknown type error
+                report_error("Unknown type for variable");
+                exit(EXIT_FAILURE);  // Return an error code
+            }
+            break;
+
+        // The condition is evaluated once more after the body has run
+        case TOKEN_IF:
+            if (frame->step == 0) {
+                frame->step = 1;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            if (frame->step == 1) {
+                frame->step = 2;
+                if ((int) result && startChild(&interpreter, node->right, &result)) {
+                    continue;
+                }
+            }
+            if (frame->step == 2) {
+                frame->step = 3;
+                if (startChild(&interpreter, node->left, &result)) {
+                    continue;
+                }
+            }
+            break;
+        case TOKEN_WHILE: {
+            int pushed = 0;
+            while (!pushed && frame->step < 2) {
+                if (frame->step == 0) {
+                    frame->step = 1;
+                    pushed = startChild(&interpreter, node->left, &result);
+                } else if ((int) result) {
+                    frame->step = 0;
+                    pushed = startChild(&interpreter, node->right, &result);
+                } else {
+                    frame->step = 2;
+                    pushed = startChild(&interpreter, node->left, &result);
+                }
+            }
+            if (pushed) {
+                continue;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+    interpreter.depth--;
+}
+free(interpreter.frames);
+free(interpreter.expressionStart);
+free(interpreter.divisor);
+free(interpreter.operands);
+return result;
+}
+
+
+// Lex the whole source, report every lexical error and return the exit status; nothing is run
+static int checkSource(const char *inputFilename) {
+    SourceBuffer source = loadSource(inputFilename);
+    LexDiagnostics diagnostics;
+    TokenList tokenList = tokenizeRecovering(source.data, source.length, &diagnostics);
+    reportLexDiagnostics(&diagnostics, source.data);
+    int status = diagnostics.size == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    freeLexDiagnostics(&diagnostics);
+    freeTokenList(&tokenList);
+    releaseSource(&source);
+    return status;
+}
+
+// Like checkSource(), but the source is read through a window of windowSize bytes instead
+// of being loaded, so memory stays bounded however large it is. Lexing stops at the first
+// error, and a lexeme longer than the window is reported as one.
+static int checkSourceStreaming(const char *inputFilename, size_t windowSize) {
+    StreamLexer lexer;
+    if (!streamLexerOpen(&lexer, inputFilename, windowSize)) {
+        return EXIT_FAILURE;
+    }
+    Token tokens[1024];
+    int status = EXIT_SUCCESS;
+    size_t count;
+    while ((count = streamLexerNextBatch(&lexer, tokens, sizeof(tokens) / sizeof(tokens[0]))) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (tokens[i].type == TOKEN_ERROR) {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+    streamLexerClose(&lexer);
+    return status;
+}
+
+// Parse tokens and flatten the tree into program; returns the number of lexical and
+// syntax errors
+static int compileTokens(const TokenList *tokenList, FlatAst *program) {
+    int errors = 0;
+    for (size_t i = 0; i < tokenList->size; i++) {
+        errors += tokenList->tokens[i].type == TOKEN_ERROR;
+    }
+    Arena nodes;
+    int syntaxErrors;
+    Node* root = parseTokenList(tokenList, &nodes, &syntaxErrors);  // Parse your language and get the AST
+    root = foldConstants(root);
+    flattenAst(root, program);
+    arenaFree(&nodes);
+    return errors + syntaxErrors;
+}
+
+// Compile a source through the AST cache: an unchanged source is loaded from its entry
+// without lexing or parsing, anything else is compiled and stored for the next run.
+// Programs with errors are never stored, so their messages appear on every run.
+static void compileSourceCached(const char *inputFilename, FlatAst *program) {
+    SourceBuffer source = loadSource(inputFilename);
+    if (loadAstCache(AST_CACHE_DIRECTORY, source.data, source.length, program)) {
+        releaseSource(&source);
+        return;
+    }
+    TokenList tokenList = tokenizeSource(source);
+    int errors = compileTokens(&tokenList, program);
+    if (errors == 0) {
+        // The list owns the source buffer, so the entry is written before it is freed
+        writeAstCache(AST_CACHE_DIRECTORY, tokenList.source, source.length, program); // best effort
+    }
+    freeTokenList(&tokenList);
+}
+
+// Usage: IW [--check [--stream[=bytes]]] [--no-cache] [--threads=n] [--dump-tokens[=file]]
+//           [--emit-tokens=file] [--load-tokens=file] [source]
+// The token dump is a debugging aid only; the parser always reads the tokens in memory.
+// --emit-tokens saves the tokens in the binary token format and --load-tokens runs such a
+// file instead of lexing a source. --check only lexes, reporting all lexical errors at once;
+// with --stream it reads the source through a window of the given size (STREAM_LEXER_WINDOW
+// by default) instead of loading it, and stops at the first error.
+// A plain run goes through the AST cache in ./.iwcache unless --no-cache is given; runs that
+// need the tokens themselves always lex and parse. --threads sets how many threads lex a
+// large source, 1 lexing it sequentially; the default is one per online processor.
+int main(int argc, char *argv[]) {
+    const char *inputFilename = "./input.txt";
+    const char *tokenDumpFilename = NULL;
+    const char *emitTokensFilename = NULL;
+    const char *loadTokensFilename = NULL;
+    int checkOnly = 0;
+    size_t streamWindow = 0;
+    int useCache = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            checkOnly = 1;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            streamWindow = STREAM_LEXER_WINDOW;
+        } else if (strncmp(argv[i], "--stream=", 9) == 0) {
+            char *endOfNumber;
+            unsigned long long window = strtoull(argv[i] + 9, &endOfNumber, 10);
+            if (*endOfNumber != '\0' || window == 0 || argv[i][9] == '-') {
+                fprintf(stderr, "Error: Invalid stream window '%s'\n", argv[i] + 9);
+                return EXIT_FAILURE;
+            }
+            streamWindow = (size_t)window;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            useCache = 0;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            char *endOfNumber;
+            long threads = strtol(argv[i] + 10, &endOfNumber, 10);
+            if (*endOfNumber != '\0' || endOfNumber == argv[i] + 10 || threads < 1 || threads > 1024) {
+                fprintf(stderr, "Error: Invalid thread count '%s'\n", argv[i] + 10);
+                return EXIT_FAILURE;
+            }
+            lexerThreadCount = (int)threads;
+        } else if (strcmp(argv[i], "--dump-tokens") == 0) {
+            tokenDumpFilename = "./output.json";
+        } else if (strncmp(argv[i], "--dump-tokens=", 14) == 0) {
+            tokenDumpFilename = argv[i] + 14;
+        } else if (strncmp(argv[i], "--emit-tokens=", 14) == 0) {
+            emitTokensFilename = argv[i] + 14;
+        } else if (strncmp(argv[i], "--load-tokens=", 14) == 0) {
+            loadTokensFilename = argv[i] + 14;
+        } else {
+            inputFilename = argv[i];
+        }
+    }
+
+    if (streamWindow != 0 && !checkOnly) {
+        fprintf(stderr, "Error: --stream only applies to --check\n");
+        return EXIT_FAILURE;
+    }
+    if (checkOnly) {
+        return streamWindow != 0 ? checkSourceStreaming(inputFilename, streamWindow) : checkSource(inputFilename);
+    }
+
+    FlatAst program;
+    if (useCache && loadTokensFilename == NULL && tokenDumpFilename == NULL && emitTokensFilename == NULL) {
+        compileSourceCached(inputFilename, &program);
+    } else {
+        TokenList tokenList;
+        if (loadTokensFilename != NULL) {
+            if (!readTokensBinary(loadTokensFilename, &tokenList)) {
+                return EXIT_FAILURE;
+            }
+            if (tokenDumpFilename != NULL) {
+                writeTokensToJson(&tokenList, tokenDumpFilename);
+            }
+        } else {
+            tokenList = performLexicalAnalysis(inputFilename, tokenDumpFilename);
+        }
+        if (emitTokensFilename != NULL && !writeTokensBinary(&tokenList, emitTokensFilename)) {
+            return EXIT_FAILURE;
+        }
+        compileTokens(&tokenList, &program);
+        freeTokenList(&tokenList);
+    }
+    printf("finished");
+    printf("\n");
+    interpret(&program, program.root);
+    freeFlatAst(&program);
+    return 0;
+}
@@ -1,304 +1,833 @@
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "arena.h"
+#include "charscan.h"
+#include "intern.h"
 #include "lexer.h"
+#include "lexer_tables.h"
+
+int lexerThreadCount = 0;
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Token type names, generated from the token specification
+static const char *const tokenTypeNames[] = {
+#define TOKEN(name, kind, spelling) "TOKEN_" #name,
+#include "tokens.def"
+#undef TOKEN
+};
 
-char* my_strndup(const char *s, size_t n) {
-    size_t len = strnlen(s, n);
-    char *new_str = (char*)malloc(len + 1);
-    if (new_str == NULL) {
-        return NULL;
+const char *tokenTypeToString(TokenType type) {
+    if ((unsigned)type >= sizeof(tokenTypeNames) / sizeof(tokenTypeNames[0])) {
+        return "UNKNOWN_TOKEN";
     }
-    new_str[len] = '\0';
-    return (char*)memcpy(new_str, s, len);
+    return tokenTypeNames[type];
 }
 
-// Token types
-
-
-const char *tokenTypeToString(TokenType type) {
-    switch (type) {
-        case TOKEN_INT_DECL: return "TOKEN_INT_DECL";
-        case TOKEN_DOUBLE_DECL: return "TOKEN_DOUBLE_DECL";
-        case TOKEN_INT_LITERAL: return "TOKEN_INT_LITERAL";
-        case TOKEN_DOUBLE_LITERAL: return "TOKEN_DOUBLE_LITERAL";
-        case TOKEN_IDENTIFIER: return "TOKEN_IDENTIFIER";
-        case TOKEN_PLUS: return "TOKEN_PLUS";
-        case TOKEN_MINUS: return "TOKEN_MINUS";
-        case TOKEN_MULTI: return "TOKEN_MULTI";
-        case TOKEN_DIVISION: return "TOKEN_DIVISION";
-        case TOKEN_ASSIGN: return "TOKEN_ASSIGN";
-        case TOKEN_LESS: return "TOKEN_LESS";
-        case TOKEN_GREATER: return "TOKEN_GREATER";
-        case TOKEN_EQUAL: return "TOKEN_EQUAL";
-        case TOKEN_LESS_OR_EQUAL: return "TOKEN_LESS_OR_EQUAL";
-        case TOKEN_GREATER_OR_EQUAL: return "TOKEN_GREATER_OR_EQUAL";
-        case TOKEN_OPEN_PAREN: return "TOKEN_OPEN_PAREN";
-        case TOKEN_CLOSE_PAREN: return "TOKEN_CLOSE_PAREN";
-        case TOKEN_OPEN_BRACE: return "TOKEN_OPEN_BRACE";
-        case TOKEN_CLOSE_BRACE: return "TOKEN_CLOSE_BRACE";
-        case TOKEN_PRINT: return "TOKEN_PRINT";
-        case TOKEN_INPUT: return "TOKEN_INPUT";
-        case TOKEN_WHILE: return "TOKEN_WHILE";
-        case TOKEN_ELSE: return "TOKEN_ELSE";
-        case TOKEN_IF: return "TOKEN_IF";
-        case TOKEN_EOF: return "TOKEN_EOF";
-        case TOKEN_ERROR: return "TOKEN_ERROR";
-        case TOKEN_NEW_LINE: return "TOKEN_NEW_LINE";
-        default: return "UNKNOWN_TOKEN";
-    }
-}
-
-
-// Token structure
-typedef struct {
-    TokenType type;
-    char *lexeme;
-} Token;
-
-// TokenList structure
-typedef struct {
-    Token *tokens;
-    size_t size;
-    size_t capacity;
-} TokenList;
+// Inverse of tokenTypeToString(); a name that is not a token type gives TOKEN_ERROR and
+// sets *found to 0. One hash and one compare, using the perfect hash lexgen generated.
+TokenType tokenTypeFromString(const char *name, size_t length, int *found) {
+    int type = lexNameSlots[lexNameHash(name, length) >> LEX_NAME_SHIFT];
+    *found = type >= 0 && strncmp(tokenTypeNames[type], name, length) == 0 && tokenTypeNames[type][length] == '\0';
+    return *found ? (TokenType)type : TOKEN_ERROR;
+}
 
-typedef struct {
-    const char *keyword;
-    TokenType type;
-} Keyword;
-
-const Keyword keywords[] = {
-        {"print", TOKEN_PRINT},
-        {"input", TOKEN_INPUT},
-        {"while", TOKEN_WHILE},
-        {"if", TOKEN_IF},
-        {"or", TOKEN_ELSE}
-};
-const int numKeywords = sizeof(keywords) / sizeof(Keyword);
+// Tokens to reserve for a source of the given length; typical code has a token every 2-4 bytes
+size_t estimateTokenCount(size_t sourceLength) {
+    return sourceLength / 3 + 16;
+}
 
-TokenType keywordLookup(const char *lexeme, size_t length) {
-    for (int i = 0; i < numKeywords; i++) {
-        if (strncmp(lexeme, keywords[i].keyword, length) == 0 && length == strlen(keywords[i].keyword)) {
-            return keywords[i].type;
-        }
-    }
-    return TOKEN_IDENTIFIER; // Not a keyword, so it's an identifier
+// Set up an empty list whose tokens and lexeme storage come from one arena
+void initTokenList(TokenList *tokenList, const char *source, size_t expectedTokens) {
+    arenaInit(&tokenList->arena, expectedTokens * sizeof(Token));
+    tokenList->tokens = (Token *)arenaAlloc(&tokenList->arena, expectedTokens * sizeof(Token));
+    tokenList->size = 0;
+    tokenList->capacity = expectedTokens;
+    tokenList->source = source;
+    tokenList->ownedSource.data = NULL;
+    tokenList->ownedSource.length = 0;
+    tokenList->ownedSource.mapped = 0;
 }
 
-// Add new token to the list
-void addToken(TokenList *tokenList, TokenType type, const char *lexeme) {
+// Add new token to the list; the lexeme is recorded as a span of the source, not copied.
+// Returns the token so a literal's value can be filled in.
+Token *addToken(TokenList *tokenList, TokenType type, const char *lexeme, size_t length) {
     if (tokenList->size >= tokenList->capacity) {
-        tokenList->capacity = tokenList->capacity < 1 ? 1 : tokenList->capacity * 2;
-        tokenList->tokens = (Token *)realloc(tokenList->tokens, tokenList->capacity * sizeof(Token));
-
+        size_t capacity = tokenList->capacity < 1 ? 1 : tokenList->capacity * 2;
+        tokenList->tokens = (Token *)arenaGrow(&tokenList->arena, tokenList->tokens,
+                                               tokenList->capacity * sizeof(Token), capacity * sizeof(Token));
+        tokenList->capacity = capacity;
     }
     tokenList->tokens[tokenList->size].type = type;
-    tokenList->tokens[tokenList->size].lexeme = strdup(lexeme);
-    tokenList->size++;
+    tokenList->tokens[tokenList->size].offset = (size_t)(lexeme - tokenList->source);
+    tokenList->tokens[tokenList->size].length = length;
+    tokenList->tokens[tokenList->size].value.doubleValue = 0.0;
+    return &tokenList->tokens[tokenList->size++];
+}
+
+const char *tokenLexeme(const TokenList *tokenList, const Token *token) {
+    return tokenList->source + token->offset;
 }
 
 void freeTokenList(TokenList *tokenList) {
-    for (size_t i = 0; i < tokenList->size; i++) {
-        free(tokenList->tokens[i].lexeme);
-    }
-    free(tokenList->tokens);
+    arenaFree(&tokenList->arena);
+    releaseSource(&tokenList->ownedSource);
+    tokenList->tokens = NULL;
+    tokenList->size = tokenList->capacity = 0;
 }
 
-char *readFileIntoString(const char *filename) {
-    FILE *file = fopen(filename, "r");
+// Fallback loader: copy the whole file into a heap buffer
+SourceBuffer readFileIntoString(const char *filename) {
+    FILE *file = fopen(filename, "rb");
     if (!file) {
         perror("Could not open source file");
         exit(EXIT_FAILURE);
     }
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+    }
+    size_t capacity = length > 0 ? (size_t)length + 1 : 4096; // unseekable input grows as it is read
 
-    char *buffer = (char *)malloc(length + 1);
+    char *buffer = (char *)malloc(capacity + 1);
     if (!buffer) {
         perror("Memory allocation failed");
         fclose(file);
         exit(EXIT_FAILURE);
     }
 
-    fread(buffer, 1, length, file);
-    buffer[length] = '\0'; // Null-terminate the string
+    size_t bytesRead = 0;
+    size_t chunk;
+    while ((chunk = fread(buffer + bytesRead, 1, capacity - bytesRead, file)) > 0) {
+        bytesRead += chunk;
+        if (bytesRead == capacity) {
+            capacity *= 2;
+            char *grown = (char *)realloc(buffer, capacity + 1);
+            if (!grown) {
+                perror("Memory allocation failed");
+                free(buffer);
+                fclose(file);
+                exit(EXIT_FAILURE);
+            }
+            buffer = grown;
+        }
+    }
+    buffer[bytesRead] = '\0'; // Null-terminate the string
 
     fclose(file);
-    return buffer;
+    SourceBuffer result = {buffer, bytesRead, 0};
+    return result;
 }
 
-TokenList tokenize(const char *source) {
-    TokenList tokenList = {NULL, 0, 0};
-    const char *start = source;
-    const char *current = source;
-    size_t sourceLength = strlen(source);
-    int line = 1;
+// Map the source file read-only so the lexer reads it straight from the page cache.
+// Empty files cannot be mapped, so they and anything else mmap refuses (pipes,
+// special files) fall back to readFileIntoString().
+SourceBuffer loadSource(const char *filename) {
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Could not open source file");
+        exit(EXIT_FAILURE);
+    }
 
-    while (*current != '\0' && (current - source) < sourceLength) {
-        if (*current == '\n') {
-            addToken(&tokenList, TOKEN_NEW_LINE, "\\n");
-            current++;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+#ifdef MADV_SEQUENTIAL
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+            SourceBuffer mapped = {(const char *)data, (size_t)info.st_size, 1};
+            return mapped;
+        }
+    }
+    close(fd);
+#endif
+    return readFileIntoString(filename);
+}
+
+void releaseSource(SourceBuffer *source) {
+    if (source->data == NULL) {
+        return;
+    }
+#ifndef _WIN32
+    if (source->mapped) {
+        munmap((void *)source->data, source->length);
+    } else {
+        free((char *)source->data);
+    }
+#else
+    free((char *)source->data);
+#endif
+    source->data = NULL;
+    source->length = 0;
+    source->mapped = 0;
+}
+
+typedef enum {
+    SCAN_TOKEN,      // a token was recognised
+    SCAN_SKIP,       // whitespace to step over
+    SCAN_STOP,       // a token that ends lexing: the "end" keyword or an error
+    SCAN_NEED_MORE   // the token may continue past the available input
+} ScanStatus;
+
+typedef struct {
+    ScanStatus status;
+    TokenType type;
+    size_t length;
+    const char *message;  // diagnostic for TOKEN_ERROR
+    TokenValue value;     // decoded literal
+} ScanResult;
+
+static ScanResult scanResult(ScanStatus status, TokenType type, size_t length) {
+    ScanResult result = {status, type, length, NULL, {0}};
+    return result;
+}
+
+static ScanResult scanError(size_t length, const char *message) {
+    ScanResult result = {SCAN_STOP, TOKEN_ERROR, length, message, {0}};
+    return result;
+}
+
+// Decode a run of decimal digits; returns 0 if the value does not fit in an int
+static int decodeInteger(const char *text, size_t length, int *value) {
+    int result = 0;
+    for (size_t i = 0; i < length; i++) {
+        int digit = text[i] - '0';
+        if (result > (INT_MAX - digit) / 10) {
+            return 0;
+        }
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return 1;
+}
+
+// Powers of ten that are exact in a double
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Decode "digits.digits"; returns 0 if the value overflows a double.
+// When the digits fit in 53 bits and there are at most 22 after the dot, both the digits
+// and the power of ten are exact doubles, so a single division rounds correctly (Clinger's
+// fast path). Anything longer goes to strtod, which needs a terminated copy of the span.
+static int decodeDouble(const char *text, size_t length, double *value) {
+    uint64_t mantissa = 0;
+    size_t fractionDigits = 0;
+    int seenDot = 0;
+    int exact = 1;
+    for (size_t i = 0; i < length && exact; i++) {
+        if (text[i] == '.') {
+            seenDot = 1;
             continue;
         }
+        mantissa = mantissa * 10 + (uint64_t)(text[i] - '0');
+        exact = mantissa < ((uint64_t)1 << 53);
+        fractionDigits += seenDot;
+    }
+    if (exact && fractionDigits < sizeof(exactPowersOfTen) / sizeof(exactPowersOfTen[0])) {
+        *value = (double)mantissa / exactPowersOfTen[fractionDigits];
+        return 1;
+    }
+
+    char small[64];
+    char *copy = length < sizeof(small) ? small : (char *)malloc(length + 1);
+    if (!copy) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    *value = strtod(copy, NULL);
+    if (copy != small) {
+        free(copy);
+    }
+    return !isinf(*value);
+}
+
+// Recognise the token starting at `current` by running the generated DFA (see tokens.def and
+// lexgen.c) until it has no transition. States that loop on identifier characters, digits or
+// blanks skip the rest of the run with the charscan kernels. `atEof` tells whether `end` is
+// the real end of the source; if it is not, a token touching `end` is SCAN_NEED_MORE.
+static ScanResult scanToken(const char *current, const char *end, int atEof) {
+    const char *p = current;
+    unsigned state = LEX_START;
+    unsigned next;
+
+    while (p < end && (next = lexTransition[state][lexCharClass[(unsigned char)*p]]) != LEX_DEAD) {
+        state = next;
+        p++;
+        switch (lexStates[state].run) {
+            case LEX_RUN_IDENTIFIER: p += scanIdentifierRun(p, end); break;
+            case LEX_RUN_DIGITS: p += scanDigitRun(p, end); break;
+            case LEX_RUN_BLANKS: p += scanSpaceRun(p, end); break;
+        }
+    }
+
+    const LexState *accepted = &lexStates[state];
+    // Whitespace never forms a token, so a partial run can be skipped as it is
+    if (accepted->action == LEX_SKIP) {
+        return scanResult(SCAN_SKIP, TOKEN_ERROR, p - current);
+    }
+    int starved = p == end && !accepted->final;
+    size_t length = p - current;
+    ScanResult result;
+
+    if (accepted->action == LEX_REJECT) {
+        result = scanError(length, accepted->message);
+    } else if (accepted->action == LEX_REJECT_LAST) {
+        result = scanError(length - 1, accepted->message); // the character that broke the token is not part of it
+    } else if (accepted->token == TOKEN_ASSIGN) {
+        // An assignment must be followed by a number or a name within two characters
+        char next1 = p < end ? p[0] : '\0';
+        char next2 = p + 1 < end ? p[1] : '\0';
+        starved = p + 1 >= end && !(p < end && charIs(next1, CHAR_DIGIT | CHAR_ALPHA));
+        if (charIs(next1, CHAR_DIGIT | CHAR_ALPHA) || charIs(next2, CHAR_DIGIT | CHAR_ALPHA)) {
+            result = scanResult(SCAN_TOKEN, TOKEN_ASSIGN, 1);
+        } else {
+            result = scanError(p < end ? 2 : 1, "Unexpected character after '='");
+        }
+    } else if (accepted->token == TOKEN_INT_LITERAL) {
+        result = scanResult(SCAN_TOKEN, TOKEN_INT_LITERAL, length);
+        if (!decodeInteger(current, length, &result.value.intValue)) {
+            result = scanError(length, "Integer literal out of range");
+        }
+    } else if (accepted->token == TOKEN_DOUBLE_LITERAL) {
+        result = scanResult(SCAN_TOKEN, TOKEN_DOUBLE_LITERAL, length);
+        if (!decodeDouble(current, length, &result.value.doubleValue)) {
+            result = scanError(length, "Double literal out of range");
+        }
+    } else {
+        // "end" reads as TOKEN_EOF and stops reading further
+        result = scanResult(accepted->token == TOKEN_EOF ? SCAN_STOP : SCAN_TOKEN, (TokenType)accepted->token, length);
+    }
+
+    if (starved && !atEof) {
+        return scanResult(SCAN_NEED_MORE, TOKEN_ERROR, 0);
+    }
+    return result;
+}
+
+static void reportLexError(const ScanResult *result, const char *lexeme, size_t line, size_t column) {
+    fprintf(stderr, "Error: %s '%.*s' at line %zu, column %zu\n",
+            result->message, (int)result->length, lexeme, line, column);
+}
+
+// 1-based line and column of a source offset
+static void sourcePosition(const char *source, size_t offset, size_t *line, size_t *column) {
+    const char *position = source + offset;
+    const char *lineStart = source;
+    *line = 1;
+    for (const char *p = source; (p = memchr(p, '\n', position - p)) != NULL; p++) {
+        (*line)++;
+        lineStart = p + 1;
+    }
+    *column = (size_t)(position - lineStart) + 1;
+}
+
+// Lets the chunks of a parallel lex see that an earlier chunk has already stopped the lex
+typedef struct {
+    atomic_int *firstStopped;   // lowest index of a chunk that stopped, or the chunk count
+    int chunk;                  // index of the chunk being lexed
+} LexCancel;
+
+// Lex the tokens that start in [from, to) into tokenList; lookahead may read up to `end`.
+// The interner is not thread-safe, so identifiers only get their symbol when internNames is set.
+// Returns 1 when lexing stopped early on "end" or an error, which *stop then describes. With
+// cancel set it also gives up, returning 0, at a line end once an earlier chunk has stopped.
+static int tokenizeRange(TokenList *tokenList, const char *from, const char *to, const char *end,
+                         int internNames, ScanResult *stop, const LexCancel *cancel) {
+    const char *current = from;
+    while (current < to) {
+        ScanResult result = scanToken(current, end, 1);
+        if (result.status != SCAN_SKIP) {
+            Token *token = addToken(tokenList, result.type, current, result.length);
+            token->value = result.value;
+            if (internNames && result.type == TOKEN_IDENTIFIER) {
+                token->value.symbol = internSymbol(current, result.length);
+            }
+        }
+        if (result.status == SCAN_STOP) {
+            *stop = result;
+            return 1;
+        }
+        current += result.length;
+        if (cancel && result.type == TOKEN_NEW_LINE &&
+            atomic_load_explicit(cancel->firstStopped, memory_order_relaxed) < cancel->chunk) {
+            return 0;
+        }
+    }
+    return 0;
+}
 
-        if (isspace(*current)) {
-            current++;
+// Report the error that ended a token list, if it ended on one
+static void reportStop(const TokenList *tokenList, const ScanResult *stop) {
+    if (stop->type != TOKEN_ERROR) {
+        return;
+    }
+    const Token *token = &tokenList->tokens[tokenList->size - 1];
+    size_t line, column;
+    sourcePosition(tokenList->source, token->offset, &line, &column);
+    reportLexError(stop, tokenLexeme(tokenList, token), line, column);
+}
+
+TokenList tokenize(const char *source, size_t length) {
+    TokenList tokenList;
+    ScanResult stop;
+
+    initTokenList(&tokenList, source, estimateTokenCount(length));
+    if (tokenizeRange(&tokenList, source, source + length, source + length, 1, &stop, NULL)) {
+        reportStop(&tokenList, &stop);
+    } else {
+        addToken(&tokenList, TOKEN_EOF, source + length, 0);
+    }
+    return tokenList;
+}
+
+static void addLexDiagnostic(LexDiagnostics *diagnostics, const LexDiagnostic *diagnostic) {
+    if (diagnostics->size == diagnostics->capacity) {
+        diagnostics->capacity = diagnostics->capacity < 16 ? 16 : diagnostics->capacity * 2;
+        diagnostics->items = (LexDiagnostic *)realloc(diagnostics->items,
+                                                      diagnostics->capacity * sizeof(LexDiagnostic));
+        if (!diagnostics->items) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    diagnostics->items[diagnostics->size++] = *diagnostic;
+}
+
+// The line number is carried along as newlines are lexed, so positions cost nothing extra
+TokenList tokenizeRecovering(const char *source, size_t length, LexDiagnostics *diagnostics) {
+    TokenList tokenList;
+    const char *current = source;
+    const char *end = source + length;
+    const char *lineStart = source;
+    size_t line = 1;
+
+    diagnostics->items = NULL;
+    diagnostics->size = 0;
+    diagnostics->capacity = 0;
+    initTokenList(&tokenList, source, estimateTokenCount(length));
+    while (current < end) {
+        ScanResult result = scanToken(current, end, 1);
+        if (result.status == SCAN_SKIP) {
+            current += result.length;
+            continue;
+        }
+        Token *token = addToken(&tokenList, result.type, current, result.length);
+        token->value = result.value;
+        if (result.type == TOKEN_IDENTIFIER) {
+            token->value.symbol = internSymbol(current, result.length);
+        } else if (result.type == TOKEN_ERROR) {
+            // Give up on the rest of the line; its newline is lexed normally
+            const char *newline = memchr(current, '\n', end - current);
+            if (newline && newline < current + token->length) {
+                token->length = newline - current;
+            }
+            LexDiagnostic diagnostic = {result.message, token->offset, token->length,
+                                        line, (size_t)(current - lineStart) + 1};
+            addLexDiagnostic(diagnostics, &diagnostic);
+            current = newline ? newline : end;
             continue;
+        } else if (result.type == TOKEN_NEW_LINE) {
+            line++;
+            lineStart = current + 1;
+        }
+        current += result.length;
+        if (result.status == SCAN_STOP) {
+            return tokenList;
+        }
+    }
+    addToken(&tokenList, TOKEN_EOF, end, 0);
+    return tokenList;
+}
 
+void reportLexDiagnostics(const LexDiagnostics *diagnostics, const char *source) {
+    for (size_t i = 0; i < diagnostics->size; i++) {
+        const LexDiagnostic *diagnostic = &diagnostics->items[i];
+        ScanResult result = scanError(diagnostic->length, diagnostic->message);
+        reportLexError(&result, source + diagnostic->offset, diagnostic->line, diagnostic->column);
+    }
+}
+
+void freeLexDiagnostics(LexDiagnostics *diagnostics) {
+    free(diagnostics->items);
+    diagnostics->items = NULL;
+    diagnostics->size = 0;
+    diagnostics->capacity = 0;
+}
+
+// Tokens each chunk of a parallel lex reserves to start with; addToken() grows the list, so
+// a chunk cut short by an earlier error or "end" never holds much more than it lexed
+#define PARALLEL_LEX_CHUNK_TOKENS 1024
+
+// One slice of a parallel lex; it starts at the beginning of a line and ends after a '\n'
+typedef struct {
+    const char *from;
+    const char *to;
+    const char *end;
+    TokenList tokens;
+    int stopped;
+    ScanResult stop;
+    LexCancel cancel;
+} LexChunk;
+
+static void *lexChunk(void *argument) {
+    LexChunk *chunk = (LexChunk *)argument;
+    if (atomic_load_explicit(chunk->cancel.firstStopped, memory_order_relaxed) < chunk->cancel.chunk) {
+        return NULL;
+    }
+    chunk->stopped = tokenizeRange(&chunk->tokens, chunk->from, chunk->to, chunk->end, 0, &chunk->stop,
+                                   &chunk->cancel);
+    if (chunk->stopped) {
+        // Lower the first stopped chunk to this one, unless an earlier chunk got there first
+        int first = atomic_load(chunk->cancel.firstStopped);
+        while (chunk->cancel.chunk < first &&
+               !atomic_compare_exchange_weak(chunk->cancel.firstStopped, &first, chunk->cancel.chunk)) {
         }
-        switch (*current) {
-            case '#': {
-                const char next = *(current + 1);
-                if (next == 'i') {
-                    addToken(&tokenList, TOKEN_INT_DECL, "#i");
-                    current += 2; // Move past the "#i"
-                } else if (next == 'd') {
-                    addToken(&tokenList, TOKEN_DOUBLE_DECL, "#d");
-                    current += 2; // Move past the "#d"
-                } else {
-                    char errorLexeme[3] = {'#', next, '\0'};
-                    addToken(&tokenList, TOKEN_ERROR, errorLexeme);
-                    current += 2; // Move past the "#" and the unrecognized character
-                    return tokenList;
-                }
-                break;
+    }
+    return NULL;
+}
+
+int onlineProcessorCount(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+// Statements never span lines, so the source is cut after '\n' characters into one chunk
+// per thread and the chunks are lexed concurrently. Token offsets are relative to the whole
+// source, so joining is a copy in chunk order up to the first chunk that stopped early;
+// later chunks are discarded, which keeps the "end" rule and reports only the first error.
+// So that little of that work is done, a chunk gives up at its next line once a chunk before
+// it has stopped.
+TokenList tokenizeParallel(const char *source, size_t length, int threadCount) {
+    if (threadCount < 2 || length < 2 * PARALLEL_LEX_MIN_CHUNK) {
+        return tokenize(source, length);
+    }
+    if ((size_t)threadCount > length / PARALLEL_LEX_MIN_CHUNK) {
+        threadCount = (int)(length / PARALLEL_LEX_MIN_CHUNK);
+    }
+
+    const char *end = source + length;
+    LexChunk *chunks = (LexChunk *)calloc(threadCount, sizeof(LexChunk));
+    pthread_t *threads = (pthread_t *)calloc(threadCount, sizeof(pthread_t));
+    int *started = (int *)calloc(threadCount, sizeof(int));
+    if (!chunks || !threads || !started) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_int firstStopped = threadCount;
+    const char *from = source;
+    int chunkCount = 0;
+    for (int i = 0; i < threadCount && from < end; i++) {
+        const char *to = end;
+        if (i + 1 < threadCount) {
+            const char *target = source + length / threadCount * (i + 1);
+            if (target < from) {
+                target = from;
             }
-            case '=':
-                if (*(current + 1) == '=') {
-                    addToken(&tokenList, TOKEN_EQUAL, "==");
-                    current += 2; // Advance past both '=' characters
-                } else {
-                    // Check if the next character is a number
-                    if (((isdigit(*(current + 1))) || (isdigit(*(current + 2)))) || ((isalpha(*(current + 1))) || (isalpha(*(current + 2))))) {
-                        addToken(&tokenList, TOKEN_ASSIGN, "=");
-                        current++;
-                    } else {
-                        // Handle the error case where the character following '=' is not a number
-                        fprintf(stderr, "Error: Unexpected character '%c' after '='\n", *(current + 1));
-                        // Add additional error handling logic as needed
-                        return tokenList;
-                    }
-                }
-                break;
-
-            case '(':
-                addToken(&tokenList, TOKEN_OPEN_PAREN, "(");
-                current++;
-                break;
-            case ')':
-                addToken(&tokenList, TOKEN_CLOSE_PAREN, ")");
-                current++;
-                break;
-            case '{':
-                addToken(&tokenList, TOKEN_OPEN_BRACE, "{");
-                current++;
-                break;
-            case '}':
-                addToken(&tokenList, TOKEN_CLOSE_BRACE, "}");
-                current++;
-                break;
-            case '+':
-                addToken(&tokenList, TOKEN_PLUS, "+");
-                current++;
-                break;
-            case '-':
-                addToken(&tokenList, TOKEN_MINUS, "-");
-                current++;
-                break;
-            case '*':
-                addToken(&tokenList, TOKEN_MULTI, "*");
-                current++;
-                break;
-            case '/':
-                addToken(&tokenList, TOKEN_DIVISION, "/");
-                current++;
-                break;
-            case '>':
-                addToken(&tokenList, TOKEN_GREATER, ">");
-                current++;
-                break;
-            case '<':
-                addToken(&tokenList, TOKEN_LESS, "<");
-                current++;
-                break;
-            default:
-                if (isdigit(*current)) {
-                    // Integer or double literal
-                    start = current;
-                    while (isdigit(*current)) {
-                        current++; // Continue with the integer part
-                    }
-
-                    if (*current == '.') {
-                        const char* dot = current;
-                        current++; // Skip the dot
-
-                        if (!isdigit(*current)) {
-                            // If there's a dot but no digits after it, it's an error
-                            addToken(&tokenList, TOKEN_ERROR, my_strndup(dot, 1));
-                            return tokenList;
-                        } else {
-                            // There are digits after the dot, it's a double literal
-                            while (isdigit(*current)) current++; // Continue with the fractional part
-
-                            // Check if there is another dot following which would indicate an error
-                            if (*current == '.') {
-                                addToken(&tokenList, TOKEN_ERROR, my_strndup(start, current - start));
-                                current++; // Skip the erroneous dot
-                                return tokenList;
-                            } else {
-                                // It's a valid double literal
-                                addToken(&tokenList, TOKEN_DOUBLE_LITERAL, my_strndup(start, current - start));
-                            }
-                        }
-                    } else {
-                        // It was just an integer literal
-                        addToken(&tokenList, TOKEN_INT_LITERAL, my_strndup(start, current - start));
-                    }
-
-
-                } else if (isalpha(*current) || *current == '_') {
-                    // Identifier or keyword
-                    start = current;
-                    while (isalnum(*current) || *current == '_') current++;
-                    size_t length = current - start;
-                    char *lexeme = my_strndup(start, length);
-
-                    if (strncmp(lexeme, "end", length) == 0 && length == 3) {
-                        free(lexeme);
-                        addToken(&tokenList, TOKEN_EOF, "end");
-                        return tokenList; // Stop reading further and return
-                    }
-
-                    TokenType type = keywordLookup(lexeme, length);
-                    addToken(&tokenList, type, lexeme);
-
-                    free(lexeme);
-                }
-                else {
-                    // Unrecognized character
-                    char unknown[2] = {*current, '\0'};
-
-                    // Print the unknown token
-                    fprintf(stderr, "Error: Unknown token '%s'\n", unknown);
-
-                    addToken(&tokenList, TOKEN_ERROR, unknown);
-                    current++;
-                    return tokenList;
-                }
-
-                break;
-        }
-    }
-
-    addToken(&tokenList, TOKEN_EOF, "EOF");
+            const char *newline = memchr(target, '\n', end - target);
+            to = newline ? newline + 1 : end;
+        }
+        LexChunk *chunk = &chunks[chunkCount++];
+        chunk->from = from;
+        chunk->to = to;
+        chunk->end = end;
+        chunk->cancel.firstStopped = &firstStopped;
+        chunk->cancel.chunk = chunkCount - 1;
+        initTokenList(&chunk->tokens, source, PARALLEL_LEX_CHUNK_TOKENS);
+        from = to;
+    }
+
+    // The calling thread lexes the first chunk itself
+    for (int i = 1; i < chunkCount; i++) {
+        started[i] = pthread_create(&threads[i], NULL, lexChunk, &chunks[i]) == 0;
+    }
+    lexChunk(&chunks[0]);
+    for (int i = 1; i < chunkCount; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            lexChunk(&chunks[i]);
+        }
+    }
+
+    int lastChunk = 0;
+    size_t total = 0;
+    for (; lastChunk < chunkCount; lastChunk++) {
+        total += chunks[lastChunk].tokens.size;
+        if (chunks[lastChunk].stopped) {
+            break;
+        }
+    }
+    int stopped = lastChunk < chunkCount;
+    if (!stopped) {
+        lastChunk = chunkCount - 1;
+    }
+
+    TokenList tokenList;
+    initTokenList(&tokenList, source, total + 1);
+    for (int i = 0; i <= lastChunk; i++) {
+        memcpy(tokenList.tokens + tokenList.size, chunks[i].tokens.tokens, chunks[i].tokens.size * sizeof(Token));
+        tokenList.size += chunks[i].tokens.size;
+    }
+    // Names are interned here, in source order, so symbols number the same as with tokenize()
+    for (size_t i = 0; i < tokenList.size; i++) {
+        Token *token = &tokenList.tokens[i];
+        if (token->type == TOKEN_IDENTIFIER) {
+            token->value.symbol = internSymbol(source + token->offset, token->length);
+        }
+    }
+    for (int i = 0; i < chunkCount; i++) {
+        freeTokenList(&chunks[i].tokens);
+    }
+
+    if (stopped) {
+        reportStop(&tokenList, &chunks[lastChunk].stop);
+    } else {
+        addToken(&tokenList, TOKEN_EOF, end, 0);
+    }
+    free(chunks);
+    free(threads);
+    free(started);
     return tokenList;
 }
 
+int streamLexerOpen(StreamLexer *lexer, const char *filename, size_t windowSize) {
+    lexer->file = fopen(filename, "rb");
+    if (!lexer->file) {
+        perror("Could not open source file");
+        return 0;
+    }
+    lexer->window = (char *)malloc(windowSize);
+    if (!lexer->window) {
+        perror("Memory allocation failed");
+        fclose(lexer->file);
+        lexer->file = NULL;
+        return 0;
+    }
+    lexer->capacity = windowSize;
+    lexer->start = 0;
+    lexer->fill = 0;
+    lexer->windowOffset = 0;
+    lexer->atEof = 0;
+    lexer->finished = 0;
+    lexer->line = 1;
+    lexer->lineOffset = 0;
+    return 1;
+}
+
+// Slide the unread tail of the window to the front and top it up from the file
+static void streamLexerRefill(StreamLexer *lexer) {
+    size_t unread = lexer->fill - lexer->start;
+    memmove(lexer->window, lexer->window + lexer->start, unread);
+    lexer->windowOffset += lexer->start;
+    lexer->start = 0;
+    lexer->fill = unread;
+
+    size_t bytesRead = fread(lexer->window + lexer->fill, 1, lexer->capacity - lexer->fill, lexer->file);
+    lexer->fill += bytesRead;
+    if (bytesRead == 0) {
+        lexer->atEof = 1;
+    }
+}
+
+static void streamLexerSetToken(const StreamLexer *lexer, Token *token, TokenType type, size_t length) {
+    token->type = type;
+    token->offset = lexer->windowOffset + lexer->start;
+    token->length = length;
+    token->value.doubleValue = 0.0;
+}
+
+// Produce the next token without refilling the window; returns 0 when the window has to be refilled first
+static int streamLexerScan(StreamLexer *lexer, Token *token, int *needMore) {
+    *needMore = 0;
+    while (lexer->start < lexer->fill) {
+        const char *current = lexer->window + lexer->start;
+        ScanResult result = scanToken(current, lexer->window + lexer->fill, lexer->atEof);
+        if (result.status == SCAN_NEED_MORE) {
+            *needMore = 1;
+            return 0;
+        }
+        if (result.status == SCAN_SKIP) {
+            lexer->start += result.length;
+            continue;
+        }
+        streamLexerSetToken(lexer, token, result.type, result.length);
+        token->value = result.value;
+        if (result.type == TOKEN_IDENTIFIER) {
+            token->value.symbol = internSymbol(current, result.length);
+        }
+        if (result.status == SCAN_STOP) {
+            if (result.type == TOKEN_ERROR) {
+                reportLexError(&result, current, lexer->line, token->offset - lexer->lineOffset + 1);
+            }
+            lexer->finished = 1;
+        }
+        if (result.type == TOKEN_NEW_LINE) {
+            lexer->line++;
+            lexer->lineOffset = token->offset + 1;
+        }
+        lexer->start += result.length;
+        return 1;
+    }
+    if (lexer->atEof) {
+        streamLexerSetToken(lexer, token, TOKEN_EOF, 0);
+        lexer->finished = 1;
+        return 1;
+    }
+    *needMore = 1;
+    return 0;
+}
+
+int streamLexerNext(StreamLexer *lexer, Token *token) {
+    return streamLexerNextBatch(lexer, token, 1) == 1;
+}
+
+size_t streamLexerNextBatch(StreamLexer *lexer, Token *tokens, size_t maxTokens) {
+    size_t count = 0;
+    int needMore;
+    while (count < maxTokens && !lexer->finished) {
+        if (streamLexerScan(lexer, &tokens[count], &needMore)) {
+            count++;
+            continue;
+        }
+        // Refilling moves the window, so only do it before the first token of a batch;
+        // that keeps every lexeme of the batch readable until the next call.
+        if (count > 0) {
+            break;
+        }
+        size_t unread = lexer->fill - lexer->start;
+        if (unread == lexer->capacity) {
+            // A single lexeme fills the whole window: it cannot be held in bounded memory
+            fprintf(stderr, "Error: Lexeme at offset %zu is longer than the %zu-byte lexer window\n",
+                    lexer->windowOffset + lexer->start, lexer->capacity);
+            streamLexerSetToken(lexer, &tokens[count++], TOKEN_ERROR, unread);
+            lexer->finished = 1;
+            break;
+        }
+        streamLexerRefill(lexer);
+    }
+    return count;
+}
+
+const char *streamLexerLexeme(const StreamLexer *lexer, const Token *token) {
+    return lexer->window + (token->offset - lexer->windowOffset);
+}
+
+void streamLexerClose(StreamLexer *lexer) {
+    if (lexer->file) {
+        fclose(lexer->file);
+    }
+    free(lexer->window);
+    lexer->file = NULL;
+    lexer->window = NULL;
+}
+
+
+// Output buffer of the JSON writer; it is flushed with one fwrite whenever it fills up
+#define JSON_WRITER_BUFFER (1 << 20)
+
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t used;
+    int failed;
+} JsonWriter;
+
+static void jsonFlush(JsonWriter *writer) {
+    if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+        writer->failed = 1;
+    }
+    writer->used = 0;
+}
+
+static void jsonWrite(JsonWriter *writer, const char *text, size_t length) {
+    if (writer->used + length > JSON_WRITER_BUFFER) {
+        jsonFlush(writer);
+        if (length > JSON_WRITER_BUFFER) {
+            writer->failed |= fwrite(text, 1, length, writer->file) != length;
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->used, text, length);
+    writer->used += length;
+}
+
+// Write a lexeme span as the body of a JSON string. Runs of characters that need no
+// escaping are copied whole.
+static void jsonWriteEscaped(JsonWriter *writer, const char *text, size_t length) {
+    static const char hexDigits[] = "0123456789abcdef";
+    size_t runStart = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        jsonWrite(writer, text + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+            case '"': jsonWrite(writer, "\\\"", 2); break;
+            case '\\': jsonWrite(writer, "\\\\", 2); break;
+            case '\n': jsonWrite(writer, "\\n", 2); break;
+            case '\r': jsonWrite(writer, "\\r", 2); break;
+            case '\t': jsonWrite(writer, "\\t", 2); break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 15]};
+                jsonWrite(writer, escape, sizeof(escape));
+            }
+        }
+    }
+    jsonWrite(writer, text + runStart, length - runStart);
+}
+
+static void jsonWriteInt(JsonWriter *writer, int value) {
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    jsonWrite(writer, p, digits + sizeof(digits) - p);
+}
+
+// The start of each token's JSON object, per token type, with its length. The name is
+// quoted by TOKEN itself: EOF must not be expanded as the <stdio.h> macro.
+#define JSON_TOKEN_PREFIX(quotedName) "    {\"type\": \"TOKEN_" quotedName "\", \"lexeme\": \""
+static const struct {
+    const char *text;
+    size_t length;
+} jsonTokenPrefixes[] = {
+#define TOKEN(name, kind, spelling) {JSON_TOKEN_PREFIX(#name), sizeof(JSON_TOKEN_PREFIX(#name)) - 1},
+#include "tokens.def"
+#undef TOKEN
+};
 
 // Function to write the list of tokens to a JSON file
 void writeTokensToJson(const TokenList *tokenList, const char *filename) {
@@ -307,27 +836,172 @@ void writeTokensToJson(const TokenList *tokenList, const char *filename) {
         perror("Could not open JSON output file");
         return;
     }
+    // Everything goes through our own buffer, so stdio's would only add a copy
+    setvbuf(file, NULL, _IONBF, 0);
 
-    fprintf(file, "{\n  \"tokens\": [\n");
+    JsonWriter writer = {file, (char *)malloc(JSON_WRITER_BUFFER), 0, 0};
+    if (!writer.buffer) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    static const char header[] = "{\n  \"tokens\": [\n";
+    jsonWrite(&writer, header, sizeof(header) - 1);
     for (size_t i = 0; i < tokenList->size; i++) {
-        fprintf(file, "    {\"type\": \"%s\", \"lexeme\": \"%s\"}",
-                tokenTypeToString(tokenList->tokens[i].type),
-                tokenList->tokens[i].lexeme);
-        if (i < tokenList->size - 1) fprintf(file, ",\n");
+        const Token *token = &tokenList->tokens[i];
+        if (i > 0) {
+            jsonWrite(&writer, ",\n", 2);
+        }
+        jsonWrite(&writer, jsonTokenPrefixes[token->type].text, jsonTokenPrefixes[token->type].length);
+        jsonWriteEscaped(&writer, tokenLexeme(tokenList, token), token->length);
+        if (token->type == TOKEN_INT_LITERAL) {
+            jsonWrite(&writer, "\", \"value\": ", 12);
+            jsonWriteInt(&writer, token->value.intValue);
+            jsonWrite(&writer, "}", 1);
+        } else if (token->type == TOKEN_DOUBLE_LITERAL) {
+            char number[64];
+            int length = snprintf(number, sizeof(number), "\", \"value\": %.17g}", token->value.doubleValue);
+            jsonWrite(&writer, number, (size_t)length);
+        } else {
+            jsonWrite(&writer, "\"}", 2);
+        }
     }
-    fprintf(file, "\n  ]\n}");
+    static const char footer[] = "\n  ]\n}";
+    jsonWrite(&writer, footer, sizeof(footer) - 1);
+    jsonFlush(&writer);
 
-    fclose(file);
+    if (fclose(file) != 0 || writer.failed) {
+        perror("Could not write JSON output file");
+    }
+    free(writer.buffer);
+}
+
+
+
+// Growable byte buffer for building the binary token file
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+static void byteBufferReserve(ByteBuffer *buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) {
+        return;
+    }
+    size_t capacity = buffer->capacity < 256 ? 256 : buffer->capacity;
+    while (capacity < buffer->size + extra) capacity *= 2;
+    buffer->data = (unsigned char *)realloc(buffer->data, capacity);
+    if (!buffer->data) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    buffer->capacity = capacity;
+}
+
+static void writeVarint(ByteBuffer *buffer, size_t value) {
+    byteBufferReserve(buffer, 10);
+    while (value >= 0x80) {
+        buffer->data[buffer->size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->size++] = (unsigned char)value;
 }
 
+// Write the tokens in the binary token format (see TOKEN_FILE_MAGIC in lexer.h).
+// Each distinct lexeme is stored once in the string table; returns 0 on failure.
+int writeTokensBinary(const TokenList *tokenList, const char *filename) {
+    ByteBuffer strings = {NULL, 0, 0};
+    ByteBuffer tokens = {NULL, 0, 0};
+
+    // Open-addressing set of the lexemes already in the string table, as table offsets + 1
+    size_t slotCount = 64;
+    while (slotCount < tokenList->size * 2) slotCount *= 2;
+    size_t *slots = (size_t *)calloc(slotCount, sizeof(size_t));
+    size_t *slotLengths = (size_t *)malloc(slotCount * sizeof(size_t));
+    if (!slots || !slotLengths) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
 
+    byteBufferReserve(&tokens, tokenList->size * 3);
+    for (size_t i = 0; i < tokenList->size; i++) {
+        const Token *token = &tokenList->tokens[i];
+        const char *lexeme = tokenLexeme(tokenList, token);
+        size_t slot = hashBytes(lexeme, token->length) & (slotCount - 1);
+        while (slots[slot] != 0 &&
+               !(slotLengths[slot] == token->length &&
+                 memcmp(strings.data + slots[slot] - 1, lexeme, token->length) == 0)) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        if (slots[slot] == 0) {
+            byteBufferReserve(&strings, token->length);
+            memcpy(strings.data + strings.size, lexeme, token->length);
+            slots[slot] = strings.size + 1;
+            slotLengths[slot] = token->length;
+            strings.size += token->length;
+        }
 
-// Main function where the lexer starts execution
-void performLexicalAnalysis(const char *inputFilename, const char *outputFilename) {
-    char *source = readFileIntoString(inputFilename);
-    TokenList tokenList = tokenize(source);
-    writeTokensToJson(&tokenList, outputFilename);
-    freeTokenList(&tokenList);
-    free(source);
+        byteBufferReserve(&tokens, 1);
+        tokens.data[tokens.size++] = (unsigned char)token->type;
+        writeVarint(&tokens, slots[slot] - 1);
+        writeVarint(&tokens, token->length);
+        if (token->type == TOKEN_INT_LITERAL || token->type == TOKEN_DOUBLE_LITERAL) {
+            uint64_t bits = (uint64_t)(int64_t)token->value.intValue;
+            if (token->type == TOKEN_DOUBLE_LITERAL) {
+                memcpy(&bits, &token->value.doubleValue, sizeof(bits));
+            }
+            byteBufferReserve(&tokens, 8);
+            for (int byte = 0; byte < 8; byte++) {
+                tokens.data[tokens.size++] = (unsigned char)(bits >> (8 * byte));
+            }
+        }
+    }
+
+    ByteBuffer header = {NULL, 0, 0};
+    byteBufferReserve(&header, 32);
+    memcpy(header.data, TOKEN_FILE_MAGIC, 4);
+    header.data[4] = TOKEN_FILE_VERSION;
+    header.size = 5;
+    writeVarint(&header, tokenList->size);
+    writeVarint(&header, strings.size);
+
+    int ok = 0;
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        perror("Could not open token output file");
+    } else {
+        ok = fwrite(header.data, 1, header.size, file) == header.size &&
+             fwrite(strings.data, 1, strings.size, file) == strings.size &&
+             fwrite(tokens.data, 1, tokens.size, file) == tokens.size;
+        ok = fclose(file) == 0 && ok;
+        if (!ok) {
+            perror("Could not write token output file");
+        }
+    }
+
+    free(header.data);
+    free(strings.data);
+    free(tokens.data);
+    free(slots);
+    free(slotLengths);
+    return ok;
+}
+
+// Main function where the lexer starts execution.
+// The token list is handed back to the caller; JSON is only written when a debug file is given.
+TokenList tokenizeSource(SourceBuffer source) {
+    int threadCount = lexerThreadCount > 0 ? lexerThreadCount : onlineProcessorCount();
+    TokenList tokenList = tokenizeParallel(source.data, source.length, threadCount);
+    tokenList.ownedSource = source; // the token spans point into it
+    return tokenList;
+}
+
+TokenList performLexicalAnalysis(const char *inputFilename, const char *debugOutputFilename) {
+    TokenList tokenList = tokenizeSource(loadSource(inputFilename));
+    if (debugOutputFilename != NULL) {
+        writeTokensToJson(&tokenList, debugOutputFilename);
+    }
+    return tokenList;
 }
 
@@ -1,41 +1,157 @@
-// lexer.h
-#ifndef LEXER_H
-#define LEXER_H
-
-
-typedef enum TokenType{
-    TOKEN_INT_DECL,
-    TOKEN_DOUBLE_DECL,
-    TOKEN_INT_LITERAL,
-    TOKEN_DOUBLE_LITERAL,
-    TOKEN_IDENTIFIER,
-    TOKEN_PLUS,
-    TOKEN_MINUS,
-    TOKEN_MULTI,
-    TOKEN_DIVISION,
-    TOKEN_ASSIGN,
-    TOKEN_LESS,
-    TOKEN_GREATER,
-    TOKEN_EQUAL,
-    TOKEN_LESS_OR_EQUAL,
-    TOKEN_GREATER_OR_EQUAL,
-    TOKEN_OPEN_PAREN,
-    TOKEN_CLOSE_PAREN,
-    TOKEN_OPEN_BRACE,
-    TOKEN_CLOSE_BRACE,
-    TOKEN_PRINT,
-    TOKEN_INPUT,
-    TOKEN_WHILE,
-    TOKEN_CONDITION,
-    TOKEN_THEN,
-    TOKEN_ELSE,
-    TOKEN_IF,
-    TOKEN_EOF,
-    TOKEN_NEW_LINE,
-    TOKEN_ERROR
-} TokenType;
-
-// Declare the function that you want to make available to other files
-void performLexicalAnalysis(const char *inputFilename, const char *outputFilename);
-
+// lexer.h
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "intern.h"
+
+// Token types, in the order of the token specification
+typedef enum TokenType{
+#define TOKEN(name, kind, spelling) TOKEN_##name,
+#include "tokens.def"
+#undef TOKEN
+} TokenType;
+
+// Binary value of a literal or name, decoded once by the lexer
+typedef union {
+    int intValue;         // TOKEN_INT_LITERAL
+    double doubleValue;   // TOKEN_DOUBLE_LITERAL
+    SymbolId symbol;      // TOKEN_IDENTIFIER, interned
+} TokenValue;
+
+// Token structure.
+// The lexeme is not copied: it is the span [offset, offset + length) of the source buffer.
+typedef struct {
+    TokenType type;
+    size_t offset;
+    size_t length;
+    TokenValue value;     // zero for tokens that are not literals or names
+} Token;
+
+// Source text handed to the lexer. It is not NUL-terminated when mapped.
+typedef struct {
+    const char *data;
+    size_t length;
+    int mapped;           // data is an mmap'd view of the file rather than a heap copy
+} SourceBuffer;
+
+// TokenList structure
+typedef struct {
+    Token *tokens;
+    size_t size;
+    size_t capacity;
+    const char *source;   // buffer the token spans point into
+    SourceBuffer ownedSource; // set when the list owns that buffer; released by freeTokenList
+    Arena arena;          // the token array and any lexeme text the list stores itself
+} TokenList;
+
+const char *tokenTypeToString(TokenType type);
+
+TokenType tokenTypeFromString(const char *name, size_t length, int *found);
+
+size_t estimateTokenCount(size_t sourceLength);
+
+void initTokenList(TokenList *tokenList, const char *source, size_t expectedTokens);
+
+Token *addToken(TokenList *tokenList, TokenType type, const char *lexeme, size_t length);
+
+SourceBuffer loadSource(const char *filename);
+
+void releaseSource(SourceBuffer *source);
+
+TokenList tokenize(const char *source, size_t length);
+
+// One lexical error found by tokenizeRecovering()
+typedef struct {
+    const char *message;
+    size_t offset;        // span of the offending text in the source
+    size_t length;
+    size_t line;          // 1-based
+    size_t column;
+} LexDiagnostic;
+
+typedef struct {
+    LexDiagnostic *items;
+    size_t size;
+    size_t capacity;
+} LexDiagnostics;
+
+// Like tokenize(), but an error does not end lexing: it is recorded in *diagnostics, kept in
+// the list as a TOKEN_ERROR token, and lexing resumes at the next newline.
+TokenList tokenizeRecovering(const char *source, size_t length, LexDiagnostics *diagnostics);
+
+// Print every diagnostic in the lexer's "Error: ..." format; source is the lexed text
+void reportLexDiagnostics(const LexDiagnostics *diagnostics, const char *source);
+
+void freeLexDiagnostics(LexDiagnostics *diagnostics);
+
+// Sources of at least two chunks are split at line ends and lexed on up to threadCount
+// threads; the result is the same token list tokenize() returns.
+#define PARALLEL_LEX_MIN_CHUNK (256 * 1024)
+
+TokenList tokenizeParallel(const char *source, size_t length, int threadCount);
+
+int onlineProcessorCount(void);
+
+// Threads performLexicalAnalysis() may use; 0 means one per online processor
+extern int lexerThreadCount;
+
+// Non-owning view of a token's text; it is not NUL-terminated, use token->length.
+const char *tokenLexeme(const TokenList *tokenList, const Token *token);
+
+void freeTokenList(TokenList *tokenList);
+
+// Pull-based lexer over a fixed-size window of the file, for sources too large to load.
+// Token offsets are positions in the whole file; a token's text is only readable through
+// streamLexerLexeme() until the next call that produces tokens.
+typedef struct {
+    FILE *file;
+    char *window;
+    size_t capacity;      // window size; no single lexeme may be longer
+    size_t start;         // next unread byte in the window
+    size_t fill;          // bytes of the window holding data
+    size_t windowOffset;  // file offset of window[0]
+    int atEof;
+    int finished;         // the final token (EOF, "end" or an error) has been returned
+    size_t line;          // line of the next token, for diagnostics
+    size_t lineOffset;    // file offset where that line starts
+} StreamLexer;
+
+#define STREAM_LEXER_WINDOW (64 * 1024)
+
+int streamLexerOpen(StreamLexer *lexer, const char *filename, size_t windowSize);
+
+// Returns 1 and fills *token, or 0 once the final token has been returned.
+int streamLexerNext(StreamLexer *lexer, Token *token);
+
+// Fills up to maxTokens tokens and returns how many were produced; 0 means the stream is done.
+size_t streamLexerNextBatch(StreamLexer *lexer, Token *tokens, size_t maxTokens);
+
+const char *streamLexerLexeme(const StreamLexer *lexer, const Token *token);
+
+void streamLexerClose(StreamLexer *lexer);
+
+void writeTokensToJson(const TokenList *tokenList, const char *filename);
+
+// Binary token file, a compact alternative to the JSON dump:
+//   "IWTK", version byte, varint token count, varint string table size,
+//   the string table (each distinct lexeme once),
+//   then per token: type byte, varint lexeme offset into the table, varint lexeme length,
+//   and for literals the decoded value as 8 little-endian bytes (int64 or IEEE double).
+// Varints are unsigned LEB128. readTokensBinary() in parser.c loads it.
+#define TOKEN_FILE_MAGIC "IWTK"
+#define TOKEN_FILE_VERSION 2
+
+int writeTokensBinary(const TokenList *tokenList, const char *filename);
+
+// Lex a loaded source on lexerThreadCount threads. The list takes ownership of the buffer
+// and releases it in freeTokenList().
+TokenList tokenizeSource(SourceBuffer source);
+
+// Lex a source file and return its tokens in memory.
+// debugOutputFilename may be NULL; otherwise the tokens are also dumped there as JSON.
+TokenList performLexicalAnalysis(const char *inputFilename, const char *debugOutputFilename);
+
 #endif // LEXER_H
\ No newline at end of file
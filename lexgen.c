@@ -0,0 +1,318 @@
+// lexgen.c - build-time generator for the lexer tables.
+// Reads the token specification in tokens.def and writes lexer_tables.h: a byte -> character
+// class table and a DFA over those classes that scanToken() in lexer.c runs, and a perfect
+// hash of the token type names for tokenTypeFromString().
+//
+// Usage: lexgen <output header>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { TK_FIXED, TK_KEYWORD, TK_PATTERN, TK_NONE };
+
+typedef struct {
+    const char *name;
+    int kind;
+    const char *spelling;
+} TokenSpec;
+
+static const TokenSpec spec[] = {
+#define TOKEN(name, kind, spelling) {"TOKEN_" #name, kind, spelling},
+#include "tokens.def"
+#undef TOKEN
+};
+static const int specCount = sizeof(spec) / sizeof(spec[0]);
+
+// Classes every table has; each character used in a spelling gets a class of its own after these
+enum { CLASS_OTHER, CLASS_BLANK, CLASS_DIGIT, CLASS_LETTER, CLASS_DOT, CLASS_FIRST_SPELLED };
+
+enum { ACTION_ACCEPT, ACTION_SKIP, ACTION_REJECT, ACTION_REJECT_LAST };
+enum { RUN_NONE, RUN_IDENTIFIER, RUN_DIGITS, RUN_BLANKS };
+
+#define MAX_CLASSES 64
+#define MAX_STATES 250
+#define DEAD 0
+#define START 1
+
+static int charClass[256];
+static int classChar[MAX_CLASSES];   // representative character of each class
+static int classCount = CLASS_FIRST_SPELLED;
+
+static int transition[MAX_STATES][MAX_CLASSES];
+static const char *stateToken[MAX_STATES];
+static int stateAction[MAX_STATES];
+static int stateRun[MAX_STATES];
+static const char *stateMessage[MAX_STATES];
+static int stateCount = 0;
+
+static int isBlank(int c) {
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static int isLetter(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int isDigit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+static int isIdentifierClass(int cls) {
+    return cls == CLASS_LETTER || cls == CLASS_DIGIT ||
+           (cls >= CLASS_FIRST_SPELLED && (isLetter(classChar[cls]) || isDigit(classChar[cls])));
+}
+
+static int newState(int action, const char *token, int run, const char *message) {
+    if (stateCount == MAX_STATES) {
+        fprintf(stderr, "lexgen: too many states\n");
+        exit(EXIT_FAILURE);
+    }
+    int state = stateCount++;
+    stateAction[state] = action;
+    stateToken[state] = token;
+    stateRun[state] = run;
+    stateMessage[state] = message;
+    return state;
+}
+
+static void buildClasses(void) {
+    for (int c = 0; c < 256; c++) {
+        charClass[c] = isBlank(c) ? CLASS_BLANK
+                     : isDigit(c) ? CLASS_DIGIT
+                     : isLetter(c) ? CLASS_LETTER
+                     : c == '.' ? CLASS_DOT
+                     : CLASS_OTHER;
+    }
+    classChar[CLASS_BLANK] = ' ';
+    classChar[CLASS_DIGIT] = '0';
+    classChar[CLASS_LETTER] = 'a';
+    classChar[CLASS_DOT] = '.';
+    for (int i = 0; i < specCount; i++) {
+        if (spec[i].spelling == NULL) {
+            continue;
+        }
+        for (const char *p = spec[i].spelling; *p; p++) {
+            unsigned char c = (unsigned char)*p;
+            if (charClass[c] < CLASS_FIRST_SPELLED) {
+                classChar[classCount] = c;
+                charClass[c] = classCount++;
+            }
+        }
+    }
+}
+
+// Follow `spelling` from START, creating states as needed; returns the last state
+static int addPath(const char *spelling, int action, const char *token, const char *message) {
+    int state = START;
+    for (const char *p = spelling; *p; p++) {
+        int cls = charClass[(unsigned char)*p];
+        if (transition[state][cls] == DEAD) {
+            transition[state][cls] = newState(action, token, RUN_NONE, message);
+        }
+        state = transition[state][cls];
+    }
+    return state;
+}
+
+static void buildDfa(void) {
+    newState(ACTION_REJECT, NULL, RUN_NONE, NULL);                 // DEAD
+    newState(ACTION_REJECT, NULL, RUN_NONE, "Unknown token");      // START
+    int firstFixed = stateCount;
+
+    // Punctuation: a trie of the fixed spellings. A prefix that is not a token itself
+    // (like '#') rejects, and swallows the character that failed to continue it.
+    for (int i = 0; i < specCount; i++) {
+        if (spec[i].kind == TK_FIXED) {
+            int state = addPath(spec[i].spelling, ACTION_REJECT, NULL, "Unknown token");
+            stateAction[state] = ACTION_ACCEPT;
+            stateToken[state] = spec[i].name;
+        }
+    }
+    int lastFixed = stateCount;
+    int bad = newState(ACTION_REJECT, NULL, RUN_NONE, "Unknown token");
+    for (int state = firstFixed; state < lastFixed; state++) {
+        if (stateAction[state] == ACTION_ACCEPT) {
+            continue;
+        }
+        for (int cls = 0; cls < classCount; cls++) {
+            if (transition[state][cls] == DEAD) {
+                transition[state][cls] = bad;
+            }
+        }
+    }
+
+    // Names: keywords are a trie whose states read as identifiers until a keyword is complete;
+    // leaving the trie on any identifier character drops into the generic identifier state.
+    int identifier = newState(ACTION_ACCEPT, "TOKEN_IDENTIFIER", RUN_IDENTIFIER, NULL);
+    int firstKeyword = stateCount;
+    for (int i = 0; i < specCount; i++) {
+        if (spec[i].kind == TK_KEYWORD) {
+            int state = addPath(spec[i].spelling, ACTION_ACCEPT, "TOKEN_IDENTIFIER", NULL);
+            stateToken[state] = spec[i].name;
+        }
+    }
+    for (int state = firstKeyword - 1; state < stateCount; state++) {
+        for (int cls = 0; cls < classCount; cls++) {
+            if (isIdentifierClass(cls) && transition[state][cls] == DEAD) {
+                transition[state][cls] = identifier;
+            }
+        }
+    }
+    for (int cls = 0; cls < classCount; cls++) {
+        if (isIdentifierClass(cls) && cls != CLASS_DIGIT && transition[START][cls] == DEAD) {
+            transition[START][cls] = identifier;
+        }
+    }
+
+    // Numbers: digits, optionally followed by '.' and more digits
+    int integer = newState(ACTION_ACCEPT, "TOKEN_INT_LITERAL", RUN_DIGITS, NULL);
+    int dot = newState(ACTION_REJECT, NULL, RUN_NONE, "Malformed number");
+    int fraction = newState(ACTION_ACCEPT, "TOKEN_DOUBLE_LITERAL", RUN_DIGITS, NULL);
+    int secondDot = newState(ACTION_REJECT_LAST, NULL, RUN_NONE, "Malformed number");
+    transition[START][CLASS_DIGIT] = integer;
+    transition[integer][CLASS_DIGIT] = integer;
+    transition[integer][CLASS_DOT] = dot;
+    transition[dot][CLASS_DIGIT] = fraction;
+    transition[fraction][CLASS_DIGIT] = fraction;
+    transition[fraction][CLASS_DOT] = secondDot;
+
+    int blank = newState(ACTION_SKIP, NULL, RUN_BLANKS, NULL);
+    transition[START][CLASS_BLANK] = blank;
+    transition[blank][CLASS_BLANK] = blank;
+
+    int invalid = newState(ACTION_REJECT, NULL, RUN_NONE, "Unknown token");
+    for (int cls = 0; cls < classCount; cls++) {
+        if (transition[START][cls] == DEAD) {
+            transition[START][cls] = invalid;
+        }
+    }
+}
+
+// Perfect hash from token type names ("TOKEN_PLUS") to types, for loading token dumps.
+// lexgen searches for a seed under which no two names share a slot.
+#define NAME_SLOTS 64
+// Slots come from the top bits of the hash: the low bits of FNV only depend on the low bits of the input
+#define NAME_SHIFT (32 - 6)
+#define MAX_NAME_SEEDS 1000000
+
+static int nameSlot[NAME_SLOTS];
+static uint32_t nameSeed;
+
+static uint32_t hashName(uint32_t seed, const char *name, size_t length) {
+    uint32_t hash = seed;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void buildNameHash(void) {
+    for (nameSeed = 2166136261u; nameSeed != 2166136261u + MAX_NAME_SEEDS; nameSeed++) {
+        int collided = 0;
+        for (int slot = 0; slot < NAME_SLOTS; slot++) {
+            nameSlot[slot] = -1;
+        }
+        for (int i = 0; i < specCount && !collided; i++) {
+            unsigned slot = hashName(nameSeed, spec[i].name, strlen(spec[i].name)) >> NAME_SHIFT;
+            collided = nameSlot[slot] != -1;
+            nameSlot[slot] = i;
+        }
+        if (!collided) {
+            return;
+        }
+    }
+    fprintf(stderr, "lexgen: no perfect hash for the token type names\n");
+    exit(EXIT_FAILURE);
+}
+
+static int isFinal(int state) {
+    for (int cls = 0; cls < classCount; cls++) {
+        if (transition[state][cls] != DEAD) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void writeByteTable(FILE *out, const char *declaration, const int *values, int count) {
+    fprintf(out, "%s = {", declaration);
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s%d%s", i % 16 == 0 ? "\n    " : "", values[i], i + 1 < count ? ", " : "\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+static void writeHeader(FILE *out) {
+    static const char *actionNames[] = {"LEX_ACCEPT", "LEX_SKIP", "LEX_REJECT", "LEX_REJECT_LAST"};
+    static const char *runNames[] = {"LEX_RUN_NONE", "LEX_RUN_IDENTIFIER", "LEX_RUN_DIGITS", "LEX_RUN_BLANKS"};
+
+    fprintf(out, "// lexer_tables.h - generated by lexgen from tokens.def. Do not edit.\n");
+    fprintf(out, "#ifndef LEXER_TABLES_H\n#define LEXER_TABLES_H\n\n#include <stddef.h>\n#include <stdint.h>\n\n");
+    fprintf(out, "#define LEX_CLASS_COUNT %d\n#define LEX_STATE_COUNT %d\n", classCount, stateCount);
+    fprintf(out, "#define LEX_DEAD %d\n#define LEX_START %d\n\n", DEAD, START);
+    fprintf(out, "enum { LEX_ACCEPT, LEX_SKIP, LEX_REJECT, LEX_REJECT_LAST };\n");
+    fprintf(out, "enum { LEX_RUN_NONE, LEX_RUN_IDENTIFIER, LEX_RUN_DIGITS, LEX_RUN_BLANKS };\n\n");
+
+    writeByteTable(out, "static const unsigned char lexCharClass[256]", charClass, 256);
+
+    fprintf(out, "static const unsigned char lexTransition[LEX_STATE_COUNT][LEX_CLASS_COUNT] = {\n");
+    for (int state = 0; state < stateCount; state++) {
+        fprintf(out, "    {");
+        for (int cls = 0; cls < classCount; cls++) {
+            fprintf(out, "%d%s", transition[state][cls], cls + 1 < classCount ? ", " : "");
+        }
+        fprintf(out, "},\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "typedef struct {\n    unsigned char token;\n    unsigned char action;\n");
+    fprintf(out, "    unsigned char run;\n    unsigned char final;   // no transitions leave the state\n");
+    fprintf(out, "    const char *message;   // diagnostic for rejecting states\n} LexState;\n\n");
+    fprintf(out, "static const LexState lexStates[LEX_STATE_COUNT] = {\n");
+    for (int state = 0; state < stateCount; state++) {
+        fprintf(out, "    {%s, %s, %s, %d, ", stateToken[state] ? stateToken[state] : "TOKEN_ERROR",
+                actionNames[stateAction[state]], runNames[stateRun[state]], isFinal(state));
+        if (stateMessage[state]) {
+            fprintf(out, "\"%s\"},\n", stateMessage[state]);
+        } else {
+            fprintf(out, "NULL},\n");
+        }
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Perfect hash of the token type names: lexNameSlots[lexNameHash(name) >> LEX_NAME_SHIFT]\n");
+    fprintf(out, "// is the only type the name can be, or -1\n");
+    fprintf(out, "#define LEX_NAME_SLOTS %d\n#define LEX_NAME_SHIFT %d\n\n", NAME_SLOTS, NAME_SHIFT);
+    fprintf(out, "static inline uint32_t lexNameHash(const char *name, size_t length) {\n");
+    fprintf(out, "    uint32_t hash = %uu;\n", nameSeed);
+    fprintf(out, "    for (size_t i = 0; i < length; i++) {\n");
+    fprintf(out, "        hash = (hash ^ (unsigned char)name[i]) * 16777619u;\n");
+    fprintf(out, "    }\n    return hash;\n}\n\n");
+    writeByteTable(out, "static const signed char lexNameSlots[LEX_NAME_SLOTS]", nameSlot, NAME_SLOTS);
+
+    fprintf(out, "#endif // LEXER_TABLES_H\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: lexgen <output header>\n");
+        return EXIT_FAILURE;
+    }
+    buildClasses();
+    if (classCount > MAX_CLASSES) {
+        fprintf(stderr, "lexgen: too many character classes\n");
+        return EXIT_FAILURE;
+    }
+    buildDfa();
+    buildNameHash();
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        perror("lexgen: could not open output");
+        return EXIT_FAILURE;
+    }
+    writeHeader(out);
+    fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -1,722 +1,796 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <limits.h>
-#include "cJSON.h"
-#include "cJSON.c"
-#include "lexer.h"
-#include "parser.h"
-
-
-
-Node* handlePrint(cJSON *tokens, int index, int end);
-
-int findTokenIndex(cJSON *tokens, int start, int end, enum TokenType targetTokenType);
-
-Node* handleIdentifier(cJSON *tokens, int index);
-
-Node* parseTokens(cJSON *tokens, int start, int end, const char* lexeme);
-
-Node* parse(cJSON *json_data_parsed) {
-    cJSON *tokens = cJSON_GetObjectItemCaseSensitive(json_data_parsed, "tokens");
-    if (cJSON_IsArray(tokens)) {
-        int array_size = cJSON_GetArraySize(tokens);
-        if (array_size > 0) {
-            return parseTokens(tokens, 0, array_size - 1, NULL);
-        } else {
-            fprintf(stderr, "Error: Empty array of tokens.\n");
-            return NULL;
-        }
-    } else {
-        fprintf(stderr, "Error: field 'tokens' isn't an array.\n");
-        return NULL;
-    }
-}
-
-enum TokenType getTokenTypeFromString(const char* typeString) {
-    if (strcmp(typeString, "TOKEN_INT_DECL") == 0) {
-        return TOKEN_INT_DECL;
-    } else if (strcmp(typeString, "TOKEN_DOUBLE_DECL") == 0) {
-        return TOKEN_DOUBLE_DECL;
-    } else if (strcmp(typeString, "TOKEN_INT_LITERAL") == 0) {
-        return TOKEN_INT_LITERAL;
-    } else if (strcmp(typeString, "TOKEN_DOUBLE_LITERAL") == 0) {
-        return TOKEN_DOUBLE_LITERAL;
-    } else if (strcmp(typeString, "TOKEN_IDENTIFIER") == 0) {
-        return TOKEN_IDENTIFIER;
-    } else if (strcmp(typeString, "TOKEN_PLUS") == 0) {
-        return TOKEN_PLUS;
-    } else if (strcmp(typeString, "TOKEN_MINUS") == 0) {
-        return TOKEN_MINUS;
-    } else if (strcmp(typeString, "TOKEN_MULTI") == 0) {
-        return TOKEN_MULTI;
-    } else if (strcmp(typeString, "TOKEN_DIVISION") == 0) {
-        return TOKEN_DIVISION;
-    } else if (strcmp(typeString, "TOKEN_ASSIGN") == 0) {
-        return TOKEN_ASSIGN;
-    } else if (strcmp(typeString, "TOKEN_LESS") == 0) {
-        return TOKEN_LESS;
-    } else if (strcmp(typeString, "TOKEN_GREATER") == 0) {
-        return TOKEN_GREATER;
-    } else if (strcmp(typeString, "TOKEN_EQUAL") == 0) {
-        return TOKEN_EQUAL;
-    } else if (strcmp(typeString, "TOKEN_LESS_OR_EQUAL") == 0) {
-        return TOKEN_LESS_OR_EQUAL;
-    } else if (strcmp(typeString, "TOKEN_GREATER_OR_EQUAL") == 0) {
-        return TOKEN_GREATER_OR_EQUAL;
-    } else if (strcmp(typeString, "TOKEN_OPEN_PAREN") == 0) {
-        return TOKEN_OPEN_PAREN;
-    } else if (strcmp(typeString, "TOKEN_CLOSE_PAREN") == 0) {
-        return TOKEN_CLOSE_PAREN;
-    } else if (strcmp(typeString, "TOKEN_OPEN_BRACE") == 0) {
-        return TOKEN_OPEN_BRACE;
-    } else if (strcmp(typeString, "TOKEN_CLOSE_BRACE") == 0) {
-        return TOKEN_CLOSE_BRACE;
-    } else if (strcmp(typeString, "TOKEN_PRINT") == 0) {
-        return TOKEN_PRINT;
-    } else if (strcmp(typeString, "TOKEN_INPUT") == 0) {
-        return TOKEN_INPUT;
-    } else if (strcmp(typeString, "TOKEN_WHILE") == 0) {
-        return TOKEN_WHILE;
-    } else if (strcmp(typeString, "TOKEN_CONDITION") == 0) {
-        return TOKEN_CONDITION;
-    } else if (strcmp(typeString, "TOKEN_THEN") == 0) {
-        return TOKEN_THEN;
-    } else if (strcmp(typeString, "TOKEN_ELSE") == 0) {
-        return TOKEN_ELSE;
-    } else if (strcmp(typeString, "TOKEN_IF") == 0) {
-        return TOKEN_IF;
-    } else if (strcmp(typeString, "TOKEN_NEW_LINE") == 0) {
-        return TOKEN_NEW_LINE;
-    } else if (strcmp(typeString, "TOKEN_EOF") == 0) {
-        return TOKEN_EOF;
-    } else {
-        fprintf(stderr, "Error: Unknown token type: %s\n", typeString);
-        return TOKEN_ERROR;
-    }
-}
-
-Node* parseexpressions(cJSON *tokens, int start, int end) {
-    int relationalOperatorIndex = -1;
-    int plusMinusIndex = -1;
-    for (int i = start; i <= end; i++) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == TOKEN_OPEN_PAREN) {
-                    int openParenCount = 1;
-                    int closeParenIndex = i + 1;
-                    while (closeParenIndex <= end && openParenCount > 0) {
-                        cJSON *innerToken = cJSON_GetArrayItem(tokens, closeParenIndex);
-                        if (cJSON_IsObject(innerToken)) {
-                            cJSON *innerType = cJSON_GetObjectItemCaseSensitive(innerToken, "type");
-                            if (cJSON_IsString(innerType)) {
-                                enum TokenType innerTokenType = getTokenTypeFromString(innerType->valuestring);
-                                if (innerTokenType == TOKEN_OPEN_PAREN) {
-                                    openParenCount++;
-                                } else if (innerTokenType == TOKEN_CLOSE_PAREN) {
-                                    openParenCount--;
-                                }
-                            }
-                        }
-                        closeParenIndex++;
-                    }
-                    i = closeParenIndex - 1;
-                    continue;
-                } else if (tokenType == TOKEN_EQUAL || tokenType == TOKEN_GREATER || tokenType == TOKEN_LESS) {
-                    relationalOperatorIndex = i;
-                    break;
-                }
-            }
-        }
-    }
-    if (relationalOperatorIndex != -1) {
-        cJSON *relationalOperatorToken = cJSON_GetArrayItem(tokens, relationalOperatorIndex);
-        Node* relationalOperatorNode = (Node*)malloc(sizeof(Node));
-        relationalOperatorNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(relationalOperatorToken, "type")->valuestring);
-        const char* relationalOperatorLexeme = cJSON_GetObjectItemCaseSensitive(relationalOperatorToken, "lexeme")->valuestring;
-        snprintf(relationalOperatorNode->lexeme, sizeof(relationalOperatorNode->lexeme), "%s", relationalOperatorLexeme);
-        relationalOperatorNode->intValue = 0;
-        relationalOperatorNode->doubleValue = 0;
-        relationalOperatorNode->left = parseexpressions(tokens, start, relationalOperatorIndex - 1);
-        relationalOperatorNode->right = parseexpressions(tokens, relationalOperatorIndex + 1, end);
-        return relationalOperatorNode;
-    }
-
-    int firstNewLineIndex = -1;
-    int endbrace = -1;
-    for (int i = end; i >= start; i--) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == TOKEN_NEW_LINE) {
-                    firstNewLineIndex = i;
-                }
-                if (tokenType == TOKEN_CLOSE_BRACE) {
-                    endbrace = i;
-                }
-            }
-        }
-    }
-    if (firstNewLineIndex != -1) {
-        Node* right = parseexpressions(tokens, start, firstNewLineIndex - 1);
-        Node* left = parseexpressions(tokens, firstNewLineIndex + 1, end);
-        Node* newLineNode = (Node*)malloc(sizeof(Node));
-        newLineNode->type = TOKEN_NEW_LINE;
-        snprintf(newLineNode->lexeme, sizeof(newLineNode->lexeme), "%s", "\n");
-
-        newLineNode->left = left;
-        newLineNode->right = right;
-        newLineNode->intValue = 0;
-        newLineNode->doubleValue = 0;
-        return newLineNode;
-    } else if (endbrace != -1){
-        return NULL;
-    }
-
-    for (int i = start; i <= end; i++) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == TOKEN_PRINT) {
-                    Node* printNode = (Node*)malloc(sizeof(Node));
-                    printNode->type = TOKEN_PRINT;
-                    const char* printLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, i), "lexeme")->valuestring;
-                    snprintf(printNode->lexeme, sizeof(printNode->lexeme), "%s", printLexeme);
-                    printNode->left = NULL;
-                    printNode->right = parseexpressions(tokens, i + 1, end);
-                    printNode->intValue = 0;
-                    printNode->doubleValue = 0;
-                    return printNode;
-                }
-                if (tokenType == TOKEN_ASSIGN){
-                    Node* assignNode = (Node*)malloc(sizeof(Node));
-                    assignNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, i), "type")->valuestring);
-                    const char* assignLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, i), "lexeme")->valuestring;
-                    snprintf(assignNode->lexeme, sizeof(assignNode->lexeme), "%s", assignLexeme);
-                    assignNode->intValue = 0;
-                    assignNode->doubleValue = 0;
-                    assignNode->left = handleIdentifier(tokens, i - 1);
-                    assignNode->right = parseexpressions(tokens, i + 1, end);
-                    return assignNode;
-                }
-                if (tokenType == TOKEN_OPEN_PAREN) {
-                    int openParenCount = 1;
-                    int closeParenIndex = i + 1;
-                    while (closeParenIndex <= end && openParenCount > 0) {
-                        cJSON *innerToken = cJSON_GetArrayItem(tokens, closeParenIndex);
-                        if (cJSON_IsObject(innerToken)) {
-                            cJSON *innerType = cJSON_GetObjectItemCaseSensitive(innerToken, "type");
-                            if (cJSON_IsString(innerType)) {
-                                enum TokenType innerTokenType = getTokenTypeFromString(innerType->valuestring);
-                                if (innerTokenType == TOKEN_OPEN_PAREN) {
-                                    openParenCount++;
-                                } else if (innerTokenType == TOKEN_CLOSE_PAREN) {
-                                    openParenCount--;
-                                }
-                            }
-                        }
-                        closeParenIndex++;
-                    }
-                    i = closeParenIndex - 1;
-                    continue;
-                } else if (tokenType == TOKEN_MINUS || tokenType == TOKEN_PLUS) {
-                    plusMinusIndex = i;
-                }
-            }
-        }
-    }
-    if (plusMinusIndex != -1) {
-        cJSON *plusMinusToken = cJSON_GetArrayItem(tokens, plusMinusIndex);
-        Node* plusMinusNode = (Node*)malloc(sizeof(Node));
-        plusMinusNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(plusMinusToken, "type")->valuestring);
-        const char* plusMinusLexeme = cJSON_GetObjectItemCaseSensitive(plusMinusToken, "lexeme")->valuestring;
-        snprintf(plusMinusNode->lexeme, sizeof(plusMinusNode->lexeme), "%s", plusMinusLexeme);
-        plusMinusNode->intValue = 0;
-        plusMinusNode->doubleValue = 0;
-        if (plusMinusIndex + 1 > end || start > plusMinusIndex - 1){
-                Node *errorNode = (Node *)malloc(sizeof(Node));
-                errorNode->type = TOKEN_ERROR;
-                const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, plusMinusIndex), "lexeme")->valuestring;
-                snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-                errorNode->left = NULL;
-                errorNode->right = NULL;
-                errorNode->intValue = 0;
-                errorNode->doubleValue = 0;
-                fprintf(stderr, "Error: Incorrect use of  '%s'\n", errorLexeme);
-                return errorNode;
-        }
-        plusMinusNode->left = parseexpressions(tokens, start, plusMinusIndex - 1);
-        plusMinusNode->right = parseexpressions(tokens, plusMinusIndex + 1, end);
-        return plusMinusNode;
-    }
-    int multDivIndex = -1;
-    for (int i = start; i <= end; i++) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == TOKEN_OPEN_PAREN) {
-                    int openParenCount = 1;
-                    int closeParenIndex = i + 1;
-                    while (closeParenIndex <= end && openParenCount > 0) {
-                        cJSON *innerToken = cJSON_GetArrayItem(tokens, closeParenIndex);
-                        if (cJSON_IsObject(innerToken)) {
-                            cJSON *innerType = cJSON_GetObjectItemCaseSensitive(innerToken, "type");
-                            if (cJSON_IsString(innerType)) {
-                                enum TokenType innerTokenType = getTokenTypeFromString(innerType->valuestring);
-
-                                if (innerTokenType == TOKEN_OPEN_PAREN) {
-                                    openParenCount++;
-                                } else if (innerTokenType == TOKEN_CLOSE_PAREN) {
-                                    openParenCount--;
-                                }
-                            }
-                        }
-                        closeParenIndex++;
-                    }
-                    i = closeParenIndex - 1;
-                    continue;
-                } else if (tokenType == TOKEN_DIVISION || tokenType == TOKEN_MULTI) {
-                    multDivIndex = i;
-                }
-            }
-        }
-    }
-    if (multDivIndex != -1) {
-        cJSON *multDivToken = cJSON_GetArrayItem(tokens, multDivIndex);
-        Node* multDivNode = (Node*)malloc(sizeof(Node));
-        multDivNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(multDivToken, "type")->valuestring);
-        const char* multDivLexeme = cJSON_GetObjectItemCaseSensitive(multDivToken, "lexeme")->valuestring;
-        snprintf(multDivNode->lexeme, sizeof(multDivNode->lexeme), "%s", multDivLexeme);
-        multDivNode->intValue = 0;
-        multDivNode->doubleValue = 0;
-        if (multDivIndex + 1 > end || start > multDivIndex - 1){
-                Node *errorNode = (Node *)malloc(sizeof(Node));
-                errorNode->type = TOKEN_ERROR;
-                const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, multDivIndex), "lexeme")->valuestring;
-                snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-                errorNode->left = NULL;
-                errorNode->right = NULL;
-                errorNode->intValue = 0;
-                errorNode->doubleValue = 0;
-                fprintf(stderr, "Error: Incorrect use of  '%s'\n", errorLexeme);
-                return errorNode;
-        }
-        multDivNode->left = parseexpressions(tokens, start, multDivIndex - 1);
-        multDivNode->right = parseexpressions(tokens, multDivIndex + 1, end);
-        return multDivNode;
-    }
-    if (start == end) {
-        cJSON *leafToken = cJSON_GetArrayItem(tokens, start);
-        Node* leafNode = (Node*)malloc(sizeof(Node));
-        leafNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(leafToken, "type")->valuestring);
-        const char* leafLexeme = cJSON_GetObjectItemCaseSensitive(leafToken, "lexeme")->valuestring;
-        snprintf(leafNode->lexeme, sizeof(leafNode->lexeme), "%s", leafLexeme);
-        leafNode->left = NULL;
-        leafNode->right = NULL;
-        if (leafNode->type == TOKEN_INT_LITERAL) {
-            leafNode->intValue = atoi(leafLexeme);
-            leafNode->doubleValue = 0.0;
-        } else if (leafNode->type == TOKEN_DOUBLE_LITERAL) {
-            leafNode->intValue = 0;
-            leafNode->doubleValue = atof(leafLexeme);
-        } else {
-            leafNode->intValue = 0;
-            leafNode->doubleValue = 0.0;
-        }
-        return leafNode;
-    }
-
-    if (start < end && cJSON_GetArrayItem(tokens, start)->type == cJSON_Object &&  cJSON_GetArrayItem(tokens, end)->type == cJSON_Object) {
-        cJSON *startType = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, start), "type");
-        cJSON *endType = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, end), "type");
-        if (cJSON_IsString(startType) && cJSON_IsString(endType) &&
-            getTokenTypeFromString(startType->valuestring) == TOKEN_OPEN_PAREN &&
-            getTokenTypeFromString(endType->valuestring) == TOKEN_CLOSE_PAREN) {
-            return parseexpressions(tokens, start + 1, end - 1);
-        }
-    }
-    return NULL;
-}
-
-Node* handleVariableDeclaration(cJSON *tokens, int index, int end) {
-    Node* declarationNode = (Node*)malloc(sizeof(Node));
-    declarationNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "type")->valuestring);
-    const char* declarationLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(declarationNode->lexeme, sizeof(declarationNode->lexeme), "%s", declarationLexeme);
-    if (index + 1 <= end) {
-        cJSON *identifierToken = cJSON_GetArrayItem(tokens, index + 1);
-        if (cJSON_IsObject(identifierToken)) {
-            cJSON *identifierType = cJSON_GetObjectItemCaseSensitive(identifierToken, "type");
-            if (cJSON_IsString(identifierType) && getTokenTypeFromString(identifierType->valuestring) == TOKEN_IDENTIFIER) {
-                Node* currentTokenNode = (Node*)malloc(sizeof(Node));
-                currentTokenNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "type")->valuestring);
-                const char* currentLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-                snprintf(currentTokenNode->lexeme, sizeof(currentTokenNode->lexeme), "%s", currentLexeme);
-                currentTokenNode->left = NULL;
-                currentTokenNode->intValue = 0;
-                currentTokenNode->doubleValue = 0;
-                Node* nextNode = (Node*)malloc(sizeof(Node));
-                nextNode->type = getTokenTypeFromString(identifierType->valuestring);
-                const char* nextLexeme = cJSON_GetObjectItemCaseSensitive(identifierToken, "lexeme")->valuestring;
-                snprintf(nextNode->lexeme, sizeof(nextNode->lexeme), "%s", nextLexeme);
-                nextNode->intValue = 0;
-                nextNode->doubleValue = 0;
-                nextNode->left = NULL;
-                nextNode->right = NULL;
-                currentTokenNode->right = nextNode;
-                if (index + 2 <= end) {
-                    cJSON *nextnextToken = cJSON_GetArrayItem(tokens, index + 2);
-                    if (cJSON_IsObject(nextnextToken)) {
-                        cJSON *nextnextTokenType = cJSON_GetObjectItemCaseSensitive(nextnextToken, "type");
-                        if (cJSON_IsString(nextnextTokenType)) {
-                            Node* nextnextNode = (Node*)malloc(sizeof(Node));
-                            nextnextNode->type = getTokenTypeFromString(nextnextTokenType->valuestring);
-                            const char* nextnextLexeme = cJSON_GetObjectItemCaseSensitive(nextnextToken, "lexeme")->valuestring;
-                            snprintf(nextnextNode->lexeme, sizeof(nextnextNode->lexeme), "%s", nextnextLexeme);
-                            nextnextNode->intValue = 0;
-                            nextnextNode->doubleValue = 0;
-                            nextnextNode->left = NULL;
-                            nextnextNode->right = NULL;
-                            nextNode->right = nextnextNode;
-                            if (index + 3 <= end) {
-                                cJSON *lastToken = cJSON_GetArrayItem(tokens, index + 3);
-                                if (cJSON_IsObject(lastToken)) {
-                                    cJSON *lastTokenType = cJSON_GetObjectItemCaseSensitive(lastToken, "type");
-                                    if (cJSON_IsString(lastTokenType)) {
-                                        Node* lastNode = (Node*)malloc(sizeof(Node));
-                                        lastNode->type = getTokenTypeFromString(lastTokenType->valuestring);
-                                        const char* lastLexeme = cJSON_GetObjectItemCaseSensitive(lastToken, "lexeme")->valuestring;
-                                        snprintf(lastNode->lexeme, sizeof(lastNode->lexeme), "%s", lastLexeme);
-                                        lastNode->left = NULL;
-                                        lastNode->right = NULL;
-                                        if (lastNode->type == TOKEN_INT_LITERAL) {
-                                            lastNode->intValue = atoi(lastLexeme);
-                                            lastNode->doubleValue = 0.0;
-                                        } else if (lastNode->type == TOKEN_DOUBLE_LITERAL) {
-                                            lastNode->intValue = 0;
-                                            lastNode->doubleValue = strtod(lastLexeme, NULL);
-                                        }
-                                        nextnextNode->right = lastNode;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                return currentTokenNode;
-            } else{
-                Node *errorNode = (Node *)malloc(sizeof(Node));
-                errorNode->type = TOKEN_ERROR;
-                const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-                snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-                errorNode->left = NULL;
-                errorNode->right = NULL;
-                errorNode->intValue = 0;
-                errorNode->doubleValue = 0;
-                fprintf(stderr, "Error: Unknown token '%s'\n", errorLexeme);
-                return errorNode;
-            }
-        }
-    }
-    return NULL;
-}
-
-int findTokenIndex(cJSON *tokens, int start, int end, enum TokenType targetTokenType) {
-    for (int i = start; i <= end; i++) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == targetTokenType) {
-                    return i;
-                }
-            }
-        }
-    }
-    return -1;
-}
-
-Node* createLeafNode(enum TokenType type, const char* lexeme) {
-    Node* leafNode = (Node*)malloc(sizeof(Node));
-    leafNode->type = type;
-    snprintf(leafNode->lexeme, sizeof(leafNode->lexeme), "%s", lexeme);
-    leafNode->left = NULL;
-    leafNode->right = NULL;
-    leafNode->intValue = 0;
-    leafNode->doubleValue = 0;
-    return leafNode;
-}
-
-Node* handleIdentifier(cJSON *tokens, int index) {
-    cJSON *token = cJSON_GetArrayItem(tokens, index);
-    Node* identifierNode = (Node*)malloc(sizeof(Node));
-    identifierNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(token, "type")->valuestring);
-    const char* identifierLexeme = cJSON_GetObjectItemCaseSensitive(token, "lexeme")->valuestring;
-    snprintf(identifierNode->lexeme, sizeof(identifierNode->lexeme), "%s", identifierLexeme);
-    identifierNode->left = NULL;
-    identifierNode->right = NULL;
-    identifierNode->intValue = 0;
-    identifierNode->doubleValue = 0;
-    return identifierNode;
-}
-
-Node* handleAssignment(cJSON *tokens, int index, int end) {
-    Node* assignNode = (Node*)malloc(sizeof(Node));
-    assignNode->type = getTokenTypeFromString(cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "type")->valuestring);
-    const char* assignLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(assignNode->lexeme, sizeof(assignNode->lexeme), "%s", assignLexeme);
-    assignNode->left = handleIdentifier(tokens, index - 1);
-    assignNode->right = parseexpressions(tokens, index + 1, end);
-    assignNode->intValue = 0;
-    assignNode->doubleValue = 0;
-    return assignNode;
-}
-
-Node* handlePrint(cJSON *tokens, int index, int end) {
-    Node* printNode = (Node*)malloc(sizeof(Node));
-    printNode->type = TOKEN_PRINT;
-    const char* printLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(printNode->lexeme, sizeof(printNode->lexeme), "%s", printLexeme);
-    printNode->left = NULL;
-    printNode->right = parseexpressions(tokens, index + 1, end);
-    printNode->intValue = 0;
-    printNode->doubleValue = 0;
-    return printNode;
-}
-
-Node* handleIf(cJSON *tokens, int index, int end) {
-    Node* ifNode = (Node*)malloc(sizeof(Node));
-    ifNode->type = TOKEN_IF;
-    snprintf(ifNode->lexeme, sizeof(ifNode->lexeme), "%s", "");
-    int openParIndex = findTokenIndex(tokens, index + 1, end, TOKEN_OPEN_PAREN);
-    int closeParIndex = findTokenIndex(tokens, openParIndex + 1, end, TOKEN_OPEN_BRACE);
-    const char* ifLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(ifNode->lexeme, sizeof(ifNode->lexeme), "%s", ifLexeme);
-    ifNode->left = parseexpressions(tokens, openParIndex + 1, closeParIndex - 2);
-    ifNode->right = parseexpressions(tokens, closeParIndex + 2, end);
-    ifNode->intValue = 0;
-    ifNode->doubleValue = 0;
-    return ifNode;
-}
-
-Node* handleWhile(cJSON *tokens, int index, int end) {
-    Node* whileNode = (Node*)malloc(sizeof(Node));
-    whileNode->type = TOKEN_WHILE;
-    snprintf(whileNode->lexeme, sizeof(whileNode->lexeme), "%s", "");
-    int openParIndex = findTokenIndex(tokens, index + 1, end, TOKEN_OPEN_PAREN);
-    int closeParIndex = findTokenIndex(tokens, openParIndex + 1, end, TOKEN_OPEN_BRACE);
-    const char* whileLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(whileNode->lexeme, sizeof(whileNode->lexeme), "%s", whileLexeme);
-    whileNode->left = parseexpressions(tokens, openParIndex + 1, closeParIndex - 2);
-    whileNode->right = parseexpressions(tokens, closeParIndex + 2, end);
-    whileNode->intValue = 0;
-    whileNode->doubleValue = 0;
-    return whileNode;
-}
-
-
-Node* handleId(cJSON *tokens, int index, int end) {
-    Node* idNode = (Node*)malloc(sizeof(Node));
-    idNode->type = TOKEN_IDENTIFIER;
-    const char* idLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-    snprintf(idNode->lexeme, sizeof(idNode->lexeme), "%s", idLexeme);
-    idNode->left = NULL;
-    idNode->right = NULL;
-    if (index + 1 <= end) {
-        cJSON *nextToken = cJSON_GetArrayItem(tokens, index + 1);
-        if (cJSON_IsObject(nextToken)) {
-            cJSON *nextTokenType = cJSON_GetObjectItemCaseSensitive(nextToken, "type");
-            if (cJSON_IsString(nextTokenType)) {
-                if (getTokenTypeFromString(nextTokenType->valuestring) == TOKEN_ASSIGN) {
-                    return handleAssignment(tokens, index+1, end);
-                } else {
-                    Node *errorNode = (Node *)malloc(sizeof(Node));
-                    errorNode->type = TOKEN_ERROR;
-                    const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-                    snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-                    errorNode->left = NULL;
-                    errorNode->right = NULL;
-                    errorNode->intValue = 0;
-                    errorNode->doubleValue = 0;
-                    fprintf(stderr, "Error: Something wrong with token '%s'\n", errorLexeme);
-                    return errorNode;
-                }
-            }
-        }
-    }
-    else{
-        Node *errorNode = (Node *)malloc(sizeof(Node));
-                    errorNode->type = TOKEN_ERROR;
-                    const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, index), "lexeme")->valuestring;
-                    snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-                    errorNode->left = NULL;
-                    errorNode->right = NULL;
-                    errorNode->intValue = 0;
-                    errorNode->doubleValue = 0;
-                    fprintf(stderr, "The variable was expected to be equated to some value. Variable name:  '%s'\n", errorLexeme);
-                    return errorNode;
-    }
-}
-
-
-
-Node* checkthatitis(cJSON *tokens, int start, int end, const char* lexeme) {
-    int i = start;
-    cJSON *token = cJSON_GetArrayItem(tokens, i);
-    if (cJSON_IsObject(token)) {
-        cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-        if (cJSON_IsString(type)) {
-            enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-            switch (tokenType) {
-                case TOKEN_EOF:
-                    return createLeafNode(TOKEN_EOF, "");
-                case TOKEN_INT_DECL:
-                case TOKEN_DOUBLE_DECL:
-                    return handleVariableDeclaration(tokens, i, end);
-                case TOKEN_IDENTIFIER:
-                    return handleId(tokens, i, end);
-                case TOKEN_PRINT:
-                    return handlePrint(tokens, i, end);
-                case TOKEN_IF:
-                    return handleIf(tokens, i, end);
-                case TOKEN_WHILE:
-                    return handleWhile(tokens, i, end);
-            }
-        }
-    }
-    return NULL;
-}
-
-
-
-Node* parseTokens(cJSON *tokens, int start, int end, const char* lexeme) {
-    if (start > end) {
-        return NULL;
-    }
-
-    int j = -1;
-    int firstNewLineIndex = -1;
-    int closeBraceIndex = -1;
-    int errorTokenIndex = -1;
-    for (int i = start; i <= end; i++) {
-        cJSON *token = cJSON_GetArrayItem(tokens, i);
-        if (cJSON_IsObject(token)) {
-            cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
-            if (cJSON_IsString(type)) {
-                enum TokenType tokenType = getTokenTypeFromString(type->valuestring);
-                if (tokenType == TOKEN_ERROR){
-                    errorTokenIndex = i;
-                    break;
-                }
-                else if (tokenType == TOKEN_OPEN_BRACE){
-                    j = i;
-                    closeBraceIndex = findTokenIndex(tokens, j + 1, end, TOKEN_CLOSE_BRACE);
-                }
-                if (j != -1){
-                    if (i>closeBraceIndex){
-                        if (tokenType == TOKEN_NEW_LINE) {
-                            firstNewLineIndex = i;
-                            break;
-
-                        }
-                    }
-                } else{
-                    if (tokenType == TOKEN_NEW_LINE) {
-                        firstNewLineIndex = i;
-                        break;
-                    }
-                }
-            }
-        }
-    }
-
-
-    if (errorTokenIndex != -1) {
-        cJSON *errorToken = cJSON_GetArrayItem(tokens, errorTokenIndex);
-        Node *errorNode = (Node *)malloc(sizeof(Node));
-        errorNode->type = TOKEN_ERROR;
-        const char *errorLexeme = cJSON_GetObjectItemCaseSensitive(errorToken, "lexeme")->valuestring;
-        snprintf(errorNode->lexeme, sizeof(errorNode->lexeme), "%s", errorLexeme);
-        errorNode->left = NULL;
-        errorNode->right = NULL;
-        errorNode->intValue = 0;
-        errorNode->doubleValue = 0;
-        return errorNode;
-    } else if (firstNewLineIndex != -1) {
-        Node* left = parseTokens(tokens, firstNewLineIndex + 1, end, lexeme);
-        Node* right = checkthatitis(tokens, start, firstNewLineIndex - 1, lexeme);
-        Node* newLineNode = (Node*)malloc(sizeof(Node));
-        newLineNode->type = TOKEN_NEW_LINE;
-        if (lexeme != NULL) {
-            snprintf(newLineNode->lexeme, sizeof(newLineNode->lexeme), "%s", lexeme);
-        } else {
-            cJSON *lexemeJson = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(tokens, firstNewLineIndex), "lexeme");
-            if (cJSON_IsString(lexemeJson)) {
-                snprintf(newLineNode->lexeme, sizeof(newLineNode->lexeme), "%s", lexemeJson->valuestring);
-            } else {
-                snprintf(newLineNode->lexeme, sizeof(newLineNode->lexeme), "%s", " ");
-            }
-        }
-        newLineNode->left = left;
-        newLineNode->right = right;
-        newLineNode->intValue = 0;
-        newLineNode->doubleValue = 0;
-        return newLineNode;
-    } else {
-        Node* eofNode = (Node*)malloc(sizeof(Node));
-        eofNode->type = TOKEN_EOF;
-        if (lexeme != NULL) {
-            snprintf(eofNode->lexeme, sizeof(eofNode->lexeme), "%s", lexeme);
-        } else {
-            cJSON *lastToken = cJSON_GetArrayItem(tokens, end);
-            cJSON *lastLexemeJson = cJSON_GetObjectItemCaseSensitive(lastToken, "lexeme");
-            if (cJSON_IsString(lastLexemeJson)) {
-                snprintf(eofNode->lexeme, sizeof(eofNode->lexeme), "%s", lastLexemeJson->valuestring);
-            } else {
-                snprintf(eofNode->lexeme, sizeof(eofNode->lexeme), "%s", " ");
-            }
-        }
-        eofNode->left = NULL;
-        eofNode->right = NULL;
-        eofNode->intValue = 0;
-        eofNode->doubleValue = 0;
-        return eofNode;
-    }
-}
-
-
-Node* Parser() {
-    FILE *file = fopen("./output.json", "r");
-    if (!file) {
-        printf("Error during opening the file output.json\n");
-        exit(EXIT_FAILURE);
-    }
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    char *json_data = (char *)malloc(file_size + 1);
-    fread(json_data, 1, file_size, file);
-    fclose(file);
-    json_data[file_size] = '\0';
-    cJSON *json_data_parsed = cJSON_Parse(json_data);
-    if (!json_data_parsed) {
-        const char *error_ptr = cJSON_GetErrorPtr();
-        if (error_ptr != NULL) {
-            fprintf(stderr, "Error printing JSON: %s\n", error_ptr);
-        }
-        free(json_data);
-        return 1;
-    }
-    Node* ast = parse(json_data_parsed);
-    printf("finished");
-    return ast;
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "cJSON.c"
+#include "intern.h"
+#include "lexer.h"
+#include "parser.h"
+
+
+
+// One expression being parsed, kept on a heap stack rather than the C stack so that deep
+// nesting and long chains cost memory, not stack depth. minPrecedence 1 is a whole
+// expression, a chain of relational operators; 2 and above is an operand made of
+// arithmetic operators binding at least that tightly, as in precedence climbing.
+typedef enum {
+    EXPRESSION_START,       // nothing read yet
+    EXPRESSION_GROUP,       // the inside of the '(' at index was just read
+    EXPRESSION_STRAY,       // the operand of the stray operator at index was just read, to be dropped
+    EXPRESSION_OPERATOR,    // looking for the next operator after left
+    EXPRESSION_RIGHT,       // the right operand of the operator at index was just read
+    EXPRESSION_CHAIN        // an operand of a relational chain was just read
+} ExpressionStage;
+
+typedef struct {
+    uint8_t minPrecedence;
+    uint8_t stage;          // an ExpressionStage
+    int index;              // the '(' of a group, or a stray or binary operator
+    Node *left;             // operand so far, or the error node of a stray operator
+    Node *last;             // relational chain: its last operator, whose right operand comes next
+} ExpressionFrame;
+
+typedef struct {
+    ExpressionFrame *frames;
+    size_t depth;
+    size_t capacity;
+} ExpressionStack;
+
+// The parser works on the lexer's token array directly: a token is found by index in O(1)
+// and its type, value and lexeme span were decoded once when the list was built. Before
+// parsing, one linear pass records where every bracket closes and every statement ends, so
+// the parser never scans ahead for them.
+typedef struct {
+    const TokenList *list;
+    int *matchingClose;     // for '(' and '{', index of the matching ')' or '}'; -1 for other tokens or when unmatched
+    int *statementEnd;      // for each token, index of the newline or error token ending its statement, or list->size
+    Arena *nodes;           // every Node of the tree is carved out of this arena
+    int *errorCount;        // syntax errors reported so far
+    ExpressionStack *expressions;   // scratch stack of the expression parser
+} ParserTokens;
+
+Node* handlePrint(const ParserTokens *tokens, int index, int end);
+
+int findTokenIndex(const ParserTokens *tokens, int start, int end, enum TokenType targetTokenType);
+
+Node* handleIdentifier(const ParserTokens *tokens, int index);
+
+Node* parseTokens(const ParserTokens *tokens, int start, int end);
+
+Node* parseexpressions(const ParserTokens *tokens, int start, int end);
+
+// Fill matchingClose with a stack per bracket kind, then statementEnd. A statement ends at
+// the first newline outside the block it opens, or at an error token.
+static void indexTokens(ParserTokens *tokens) {
+    const TokenList *list = tokens->list;
+    int size = (int)list->size;
+    tokens->matchingClose = (int *)malloc((size_t)size * sizeof(int));
+    tokens->statementEnd = (int *)malloc((size_t)size * sizeof(int));
+    int *openStack = (int *)malloc((size_t)size * 2 * sizeof(int));
+    if (!tokens->matchingClose || !tokens->statementEnd || !openStack) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    int *parenStack = openStack;
+    int *braceStack = openStack + size;
+    int parenDepth = 0;
+    int braceDepth = 0;
+    for (int i = 0; i < size; i++) {
+        tokens->matchingClose[i] = -1;
+        switch (list->tokens[i].type) {
+            case TOKEN_OPEN_PAREN: parenStack[parenDepth++] = i; break;
+            case TOKEN_OPEN_BRACE: braceStack[braceDepth++] = i; break;
+            case TOKEN_CLOSE_PAREN:
+                if (parenDepth > 0) {
+                    tokens->matchingClose[parenStack[--parenDepth]] = i;
+                }
+                break;
+            case TOKEN_CLOSE_BRACE:
+                if (braceDepth > 0) {
+                    tokens->matchingClose[braceStack[--braceDepth]] = i;
+                }
+                break;
+            default: break;
+        }
+    }
+    free(openStack);
+
+    int statementStart = 0;
+    int blockClose = -1;
+    for (int i = 0; i < size; i++) {
+        enum TokenType type = list->tokens[i].type;
+        if (type == TOKEN_OPEN_BRACE && tokens->matchingClose[i] > blockClose) {
+            blockClose = tokens->matchingClose[i];
+        } else if (type == TOKEN_ERROR || (type == TOKEN_NEW_LINE && i > blockClose)) {
+            for (int j = statementStart; j <= i; j++) {
+                tokens->statementEnd[j] = i;
+            }
+            statementStart = i + 1;
+            blockClose = -1;
+        }
+    }
+    for (int j = statementStart; j < size; j++) {
+        tokens->statementEnd[j] = size;
+    }
+}
+
+Node* parse(const TokenList *tokenList, Arena *nodes, int *errorCount) {
+    *errorCount = 0;
+    if (tokenList->size > 0) {
+        ExpressionStack expressions = {NULL, 0, 0};
+        ParserTokens tokens = {tokenList, NULL, NULL, nodes, errorCount, &expressions};
+        indexTokens(&tokens);
+        Node* ast = parseTokens(&tokens, 0, (int)tokenList->size - 1);
+        free(tokens.matchingClose);
+        free(tokens.statementEnd);
+        free(expressions.frames);
+        return ast;
+    } else {
+        fprintf(stderr, "Error: Empty array of tokens.\n");
+        (*errorCount)++;
+        return NULL;
+    }
+}
+
+// Token at index, or NULL outside the list
+static const Token *tokenAt(const ParserTokens *tokens, int index) {
+    if (index < 0 || (size_t)index >= tokens->list->size) {
+        return NULL;
+    }
+    return &tokens->list->tokens[index];
+}
+
+static enum TokenType tokenTypeAt(const ParserTokens *tokens, int index) {
+    const Token *token = tokenAt(tokens, index);
+    return token ? token->type : TOKEN_ERROR;
+}
+
+// Print message followed by the quoted text of token index
+static void reportToken(const ParserTokens *tokens, const char *message, int index) {
+    const Token *token = tokenAt(tokens, index);
+    int length = token ? (int)token->length : 0;
+    fprintf(stderr, "%s'%.*s'\n", message, length, token ? tokenLexeme(tokens->list, token) : "");
+    (*tokens->errorCount)++;
+}
+
+// Fill the payload of a node from token index: the decoded value of a literal or the symbol
+// of a name when the node has the token's own type, and no children otherwise
+static void setTokenValue(Node *node, const ParserTokens *tokens, int index) {
+    const Token *token = tokenAt(tokens, index);
+    node->left = NULL;
+    node->right = NULL;
+    if (node->type == TOKEN_IDENTIFIER) {
+        node->symbol = token && token->type == TOKEN_IDENTIFIER ? token->value.symbol : SYMBOL_NONE;
+    } else if (node->type == TOKEN_INT_LITERAL) {
+        node->intValue = token && token->type == TOKEN_INT_LITERAL ? token->value.intValue : 0;
+    } else if (node->type == TOKEN_DOUBLE_LITERAL) {
+        node->doubleValue = token && token->type == TOKEN_DOUBLE_LITERAL ? token->value.doubleValue : 0.0;
+    }
+}
+
+// A fresh node from the arena; allocating one is a pointer bump
+static Node* allocateNode(const ParserTokens *tokens) {
+    return (Node*)arenaAlloc(tokens->nodes, sizeof(Node));
+}
+
+// Node of the given type with no children, carrying the value of token index
+static Node* createTokenNode(enum TokenType type, const ParserTokens *tokens, int index) {
+    Node* node = allocateNode(tokens);
+    node->type = (uint8_t)type;
+    setTokenValue(node, tokens, index);
+    return node;
+}
+
+// Error node for token index, reported with message
+static Node* createErrorNode(const ParserTokens *tokens, const char *message, int index) {
+    reportToken(tokens, message, index);
+    return createTokenNode(TOKEN_ERROR, tokens, index);
+}
+
+// Index of the ')' or '}' matching the bracket at openIndex, or end when it is not closed by end
+static int closingIndex(const ParserTokens *tokens, int openIndex, int end) {
+    int closeIndex = tokens->matchingClose[openIndex];
+    return closeIndex != -1 && closeIndex <= end ? closeIndex : end;
+}
+
+// Binding power of a binary operator, or 0 for any other token. Relational operators bind
+// loosest and group to the right; + - and * / group to the left.
+static int binaryPrecedence(enum TokenType type) {
+    switch (type) {
+        case TOKEN_EQUAL:
+        case TOKEN_GREATER:
+        case TOKEN_LESS:
+            return 1;
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:
+            return 2;
+        case TOKEN_MULTI:
+        case TOKEN_DIVISION:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+static int isArithmeticOperator(enum TokenType type) {
+    return binaryPrecedence(type) > 1;
+}
+
+// Cursor of the expression parser over the tokens [position, end] of one statement
+typedef struct {
+    const ParserTokens *tokens;
+    int position;
+    int end;
+} ExpressionParser;
+
+static enum TokenType peekType(const ExpressionParser *parser) {
+    return parser->position <= parser->end ? tokenTypeAt(parser->tokens, parser->position) : TOKEN_EOF;
+}
+
+// An arithmetic operator missing an operand becomes an error node in place of its subtree
+static Node* operatorError(const ParserTokens *tokens, int operatorIndex) {
+    return createErrorNode(tokens, "Error: Incorrect use of  ", operatorIndex);
+}
+
+static void pushExpression(ExpressionStack *stack, int minPrecedence) {
+    if (stack->depth == stack->capacity) {
+        stack->capacity = stack->capacity < 64 ? 64 : stack->capacity * 2;
+        ExpressionFrame *grown = (ExpressionFrame *)realloc(stack->frames, stack->capacity * sizeof(ExpressionFrame));
+        if (!grown) {
+            perror("Memory allocation failed");
+            exit(EXIT_FAILURE);
+        }
+        stack->frames = grown;
+    }
+    ExpressionFrame *frame = &stack->frames[stack->depth++];
+    frame->minPrecedence = (uint8_t)minPrecedence;
+    frame->stage = EXPRESSION_START;
+    frame->index = -1;
+    frame->left = NULL;
+    frame->last = NULL;
+}
+
+// Parse an expression from the parser's position. Each token is consumed once. An operand
+// is a literal or name, a parenthesised expression, or nothing; arithmetic operators group
+// to the left and relational ones, binding loosest, to the right, a < b < c being
+// a < (b < c). A frame whose operand is another expression pushes a frame for it and
+// picks up its value, in `value`, once that frame is popped.
+static Node* parseExpression(ExpressionParser *parser) {
+    ExpressionStack *stack = parser->tokens->expressions;
+    Node *value = NULL;
+    pushExpression(stack, 1);
+    while (stack->depth > 0) {
+        ExpressionFrame *frame = &stack->frames[stack->depth - 1];
+        enum TokenType type;
+        switch ((ExpressionStage)frame->stage) {
+            case EXPRESSION_START:
+                if (frame->minPrecedence == 1) {
+                    frame->stage = EXPRESSION_CHAIN;
+                    pushExpression(stack, 2);
+                    continue;
+                }
+                type = peekType(parser);
+                frame->stage = EXPRESSION_OPERATOR;
+                if (parser->position > parser->end || type == TOKEN_CLOSE_PAREN || binaryPrecedence(type) == 1) {
+                    continue;   // no operand here
+                }
+                frame->index = parser->position++;
+                if (isArithmeticOperator(type)) {
+                    // Nothing on its left: report it and skip the operand it would have taken
+                    frame->left = operatorError(parser->tokens, frame->index);
+                    frame->stage = EXPRESSION_STRAY;
+                    pushExpression(stack, binaryPrecedence(type) + 1);
+                } else if (type == TOKEN_OPEN_PAREN) {
+                    frame->stage = EXPRESSION_GROUP;
+                    pushExpression(stack, 1);
+                } else {
+                    frame->left = createTokenNode(type, parser->tokens, frame->index);
+                }
+                continue;
+
+            case EXPRESSION_GROUP:
+                if (peekType(parser) == TOKEN_CLOSE_PAREN) {
+                    parser->position++;
+                    frame->left = value;
+                } else {
+                    // Stray tokens before the ')': the group has no value
+                    parser->position = closingIndex(parser->tokens, frame->index, parser->end) + 1;
+                }
+                frame->stage = EXPRESSION_OPERATOR;
+                continue;
+
+            case EXPRESSION_STRAY:
+                frame->stage = EXPRESSION_OPERATOR;
+                continue;
+
+            case EXPRESSION_OPERATOR: {
+                type = peekType(parser);
+                int precedence = binaryPrecedence(type);
+                if (precedence == 0 || precedence < frame->minPrecedence) {
+                    value = frame->left;
+                    stack->depth--;
+                    continue;
+                }
+                frame->index = parser->position++;
+                frame->stage = EXPRESSION_RIGHT;
+                pushExpression(stack, precedence + 1);
+                continue;
+            }
+
+            case EXPRESSION_RIGHT:
+                if (parser->position == frame->index + 1) {
+                    frame->left = operatorError(parser->tokens, frame->index);
+                } else {
+                    Node *operatorNode = createTokenNode(tokenTypeAt(parser->tokens, frame->index), parser->tokens,
+                                                         frame->index);
+                    operatorNode->left = frame->left;
+                    operatorNode->right = value;
+                    frame->left = operatorNode;
+                }
+                frame->stage = EXPRESSION_OPERATOR;
+                continue;
+
+            case EXPRESSION_CHAIN: {
+                // Each relational operator is the right operand of the one before; left holds the first
+                Node *next = value;
+                type = peekType(parser);
+                if (binaryPrecedence(type) == 1) {
+                    next = createTokenNode(type, parser->tokens, parser->position++);
+                    next->left = value;
+                }
+                if (frame->last) {
+                    frame->last->right = next;
+                } else {
+                    frame->left = next;
+                }
+                if (next == value) {
+                    value = frame->left;
+                    stack->depth--;
+                } else {
+                    frame->last = next;
+                    pushExpression(stack, 2);
+                }
+                continue;
+            }
+        }
+    }
+    return value;
+}
+
+// One statement of a block, with no newline in [start, end]: a print, an assignment or
+// an expression. A print or an assignment takes the rest of the line as its operand, which
+// may be another print or assignment; that chain is followed in a loop, and a '}' anywhere
+// after one of them closes the body and leaves it without an operand.
+static Node* parseStatementExpression(const ParserTokens *tokens, int start, int end) {
+    int lastCloseBrace = -1;
+    for (int i = start; i <= end; i++) {
+        if (tokenTypeAt(tokens, i) == TOKEN_CLOSE_BRACE) {
+            lastCloseBrace = i;
+        }
+    }
+
+    Node *root = NULL;
+    Node **slot = &root;
+    for (;;) {
+        Node *statement = NULL;
+        int i = start;
+        for (; i <= end && !statement; i++) {
+            enum TokenType tokenType = tokenTypeAt(tokens, i);
+            if (tokenType == TOKEN_OPEN_PAREN) {
+                i = closingIndex(tokens, i, end);
+            } else if (tokenType == TOKEN_PRINT) {
+                statement = createTokenNode(TOKEN_PRINT, tokens, i);
+            } else if (tokenType == TOKEN_ASSIGN) {
+                statement = createTokenNode(tokenType, tokens, i);
+                statement->left = handleIdentifier(tokens, i - 1);
+            }
+        }
+        if (!statement) {
+            ExpressionParser parser = {tokens, start, end};
+            Node *expression = parseExpression(&parser);
+            *slot = parser.position > end ? expression : NULL;
+            return root;
+        }
+        *slot = statement;
+        if (lastCloseBrace >= i) {
+            return root;
+        }
+        slot = &statement->right;
+        start = i;
+    }
+}
+
+// Block node with room for capacity statements; statementCount counts those added so far
+static Node* createBlockNode(const ParserTokens *tokens, int capacity) {
+    Node* block = allocateNode(tokens);
+    block->type = (uint8_t)TOKEN_NEW_LINE;
+    block->statements = (Node**)arenaAlloc(tokens->nodes, (size_t)capacity * sizeof(Node*));
+    block->statementCount = 0;
+    return block;
+}
+
+static void addStatement(Node *block, Node *statement) {
+    if (statement) {
+        block->statements[block->statementCount++] = statement;
+    }
+}
+
+// Statements of a block body, or an expression. A body with newlines becomes a NEW_LINE
+// block holding one statement per line; a line holding a '}' closes the body and adds none.
+Node* parseexpressions(const ParserTokens *tokens, int start, int end) {
+    int newLines = 0;
+    for (int i = start; i <= end; i++) {
+        newLines += tokenTypeAt(tokens, i) == TOKEN_NEW_LINE;
+    }
+
+    Node *body = newLines > 0 ? createBlockNode(tokens, newLines + 1) : NULL;
+    int pieceStart = start;
+    int closesBody = 0;
+    for (int i = start; i <= end; i++) {
+        enum TokenType tokenType = tokenTypeAt(tokens, i);
+        if (tokenType == TOKEN_CLOSE_BRACE) {
+            closesBody = 1;
+        } else if (tokenType == TOKEN_NEW_LINE) {
+            addStatement(body, closesBody ? NULL : parseStatementExpression(tokens, pieceStart, i - 1));
+            pieceStart = i + 1;
+            closesBody = 0;
+        }
+    }
+    Node *last = closesBody ? NULL : parseStatementExpression(tokens, pieceStart, end);
+    if (!body) {
+        return last;
+    }
+    addStatement(body, last);
+    return body;
+}
+
+Node* handleVariableDeclaration(const ParserTokens *tokens, int index, int end) {
+    if (index + 1 <= end) {
+        if (tokenTypeAt(tokens, index + 1) == TOKEN_IDENTIFIER) {
+            Node* currentTokenNode = createTokenNode(tokenTypeAt(tokens, index), tokens, index);
+            currentTokenNode->right = createTokenNode(TOKEN_IDENTIFIER, tokens, index + 1);
+            return currentTokenNode;
+        } else{
+            return createErrorNode(tokens, "Error: Unknown token ", index);
+        }
+    }
+    return NULL;
+}
+
+int findTokenIndex(const ParserTokens *tokens, int start, int end, enum TokenType targetTokenType) {
+    for (int i = start; i <= end; i++) {
+        if (tokenTypeAt(tokens, i) == targetTokenType) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+Node* createLeafNode(const ParserTokens *tokens, enum TokenType type) {
+    Node* leafNode = allocateNode(tokens);
+    leafNode->type = (uint8_t)type;
+    leafNode->left = NULL;
+    leafNode->right = NULL;
+    return leafNode;
+}
+
+Node* handleIdentifier(const ParserTokens *tokens, int index) {
+    return createTokenNode(tokenTypeAt(tokens, index), tokens, index);
+}
+
+Node* handleAssignment(const ParserTokens *tokens, int index, int end) {
+    Node* assignNode = createTokenNode(tokenTypeAt(tokens, index), tokens, index);
+    assignNode->left = handleIdentifier(tokens, index - 1);
+    assignNode->right = parseexpressions(tokens, index + 1, end);
+    return assignNode;
+}
+
+Node* handlePrint(const ParserTokens *tokens, int index, int end) {
+    Node* printNode = createTokenNode(TOKEN_PRINT, tokens, index);
+    printNode->right = parseexpressions(tokens, index + 1, end);
+    return printNode;
+}
+
+// Index of the '{' opening an if or while block: the token after the ')' matching the
+// condition's '(', or failing that the next '{' at all
+static int blockOpenIndex(const ParserTokens *tokens, int openParIndex, int end) {
+    if (tokenTypeAt(tokens, openParIndex) == TOKEN_OPEN_PAREN) {
+        int closeParIndex = tokens->matchingClose[openParIndex];
+        if (closeParIndex != -1 && closeParIndex < end && tokenTypeAt(tokens, closeParIndex + 1) == TOKEN_OPEN_BRACE) {
+            return closeParIndex + 1;
+        }
+    }
+    return findTokenIndex(tokens, openParIndex + 1, end, TOKEN_OPEN_BRACE);
+}
+
+Node* handleIf(const ParserTokens *tokens, int index, int end) {
+    Node* ifNode = createTokenNode(TOKEN_IF, tokens, index);
+    int openParIndex = findTokenIndex(tokens, index + 1, end, TOKEN_OPEN_PAREN);
+    int openBraceIndex = blockOpenIndex(tokens, openParIndex, end);
+    ifNode->left = parseexpressions(tokens, openParIndex + 1, openBraceIndex - 2);
+    ifNode->right = parseexpressions(tokens, openBraceIndex + 2, end);
+    return ifNode;
+}
+
+Node* handleWhile(const ParserTokens *tokens, int index, int end) {
+    Node* whileNode = createTokenNode(TOKEN_WHILE, tokens, index);
+    int openParIndex = findTokenIndex(tokens, index + 1, end, TOKEN_OPEN_PAREN);
+    int openBraceIndex = blockOpenIndex(tokens, openParIndex, end);
+    whileNode->left = parseexpressions(tokens, openParIndex + 1, openBraceIndex - 2);
+    whileNode->right = parseexpressions(tokens, openBraceIndex + 2, end);
+    return whileNode;
+}
+
+
+Node* handleId(const ParserTokens *tokens, int index, int end) {
+    if (index + 1 <= end) {
+        if (tokenTypeAt(tokens, index + 1) == TOKEN_ASSIGN) {
+            return handleAssignment(tokens, index+1, end);
+        } else {
+            return createErrorNode(tokens, "Error: Something wrong with token ", index);
+        }
+    }
+    else{
+        return createErrorNode(tokens, "The variable was expected to be equated to some value. Variable name:  ", index);
+    }
+}
+
+
+
+Node* checkthatitis(const ParserTokens *tokens, int start, int end) {
+    int i = start;
+    switch (tokenTypeAt(tokens, i)) {
+        case TOKEN_EOF:
+            return createLeafNode(tokens, TOKEN_EOF);
+        case TOKEN_INT_DECL:
+        case TOKEN_DOUBLE_DECL:
+            return handleVariableDeclaration(tokens, i, end);
+        case TOKEN_IDENTIFIER:
+            return handleId(tokens, i, end);
+        case TOKEN_PRINT:
+            return handlePrint(tokens, i, end);
+        case TOKEN_IF:
+            return handleIf(tokens, i, end);
+        case TOKEN_WHILE:
+            return handleWhile(tokens, i, end);
+        default:
+            return NULL;
+    }
+}
+
+
+
+// The program: a NEW_LINE block of its statements, ended by an EOF node, or by an error
+// node at the first statement holding an error token. Built in a loop, so the depth of the
+// C stack does not depend on the length of the program.
+Node* parseTokens(const ParserTokens *tokens, int start, int end) {
+    if (start > end) {
+        return NULL;
+    }
+
+    int statementCount = 0;
+    int position = start;
+    while (position <= end && tokens->statementEnd[position] <= end &&
+           tokenTypeAt(tokens, tokens->statementEnd[position]) != TOKEN_ERROR) {
+        statementCount++;
+        position = tokens->statementEnd[position] + 1;
+    }
+
+    Node* tail = NULL;
+    if (position <= end && tokens->statementEnd[position] <= end) {
+        tail = createTokenNode(TOKEN_ERROR, tokens, tokens->statementEnd[position]);
+    } else if (position <= end) {
+        tail = createTokenNode(TOKEN_EOF, tokens, end);
+    }
+    if (statementCount == 0) {
+        return tail;
+    }
+
+    int *statementStarts = (int *)malloc((size_t)statementCount * sizeof(int));
+    if (!statementStarts) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    position = start;
+    for (int i = 0; i < statementCount; i++) {
+        statementStarts[i] = position;
+        position = tokens->statementEnd[position] + 1;
+    }
+
+    // Statements are parsed from the last one back, and their syntax errors reported in that order
+    Node* block = createBlockNode(tokens, statementCount + 1);
+    for (int i = statementCount - 1; i >= 0; i--) {
+        block->statements[i] = checkthatitis(tokens, statementStarts[i], tokens->statementEnd[statementStarts[i]] - 1);
+    }
+    free(statementStarts);
+    for (int i = 0; i < statementCount; i++) {
+        addStatement(block, block->statements[i]);
+    }
+    addStatement(block, tail);
+    return block;
+}
+
+static int readVarint(const unsigned char **cursor, const unsigned char *end, size_t *value) {
+    size_t result = 0;
+    for (int shift = 0; *cursor < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*cursor)++;
+        result |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Load a token file written by writeTokensBinary() in a single pass. The token lexemes
+// point into the loaded file, which the list keeps. Returns 0 if the file is not valid.
+int readTokensBinary(const char *filename, TokenList *tokenList) {
+    SourceBuffer file = loadSource(filename);
+    const unsigned char *cursor = (const unsigned char *)file.data;
+    const unsigned char *end = cursor + file.length;
+    size_t count, tableSize;
+
+    if (file.length < 5 || memcmp(cursor, TOKEN_FILE_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: '%s' is not a token file\n", filename);
+        releaseSource(&file);
+        return 0;
+    }
+    if (cursor[4] != TOKEN_FILE_VERSION) {
+        fprintf(stderr, "Error: token file '%s' has version %d, expected %d\n", filename, cursor[4], TOKEN_FILE_VERSION);
+        releaseSource(&file);
+        return 0;
+    }
+    cursor += 5;
+    if (!readVarint(&cursor, end, &count) || !readVarint(&cursor, end, &tableSize) ||
+        tableSize > (size_t)(end - cursor) || count > (size_t)(end - cursor)) {
+        fprintf(stderr, "Error: token file '%s' is truncated\n", filename);
+        releaseSource(&file);
+        return 0;
+    }
+    const char *table = (const char *)cursor;
+    cursor += tableSize;
+
+    initTokenList(tokenList, table, count);
+    tokenList->ownedSource = file;
+    for (size_t i = 0; i < count; i++) {
+        size_t offset, length;
+        if (cursor >= end || *cursor > TOKEN_ERROR) {
+            break;
+        }
+        TokenType type = (TokenType)*cursor++;
+        if (!readVarint(&cursor, end, &offset) || !readVarint(&cursor, end, &length) ||
+            offset > tableSize || length > tableSize - offset) {
+            break;
+        }
+        Token *token = addToken(tokenList, type, table + offset, length);
+        if (type == TOKEN_IDENTIFIER) {
+            token->value.symbol = internSymbol(table + offset, length);
+        } else if (type == TOKEN_INT_LITERAL || type == TOKEN_DOUBLE_LITERAL) {
+            if ((size_t)(end - cursor) < 8) {
+                tokenList->size--;
+                break;
+            }
+            uint64_t bits = 0;
+            for (int byte = 7; byte >= 0; byte--) {
+                bits = bits << 8 | cursor[byte];
+            }
+            cursor += 8;
+            if (type == TOKEN_INT_LITERAL) {
+                token->value.intValue = (int)(int64_t)bits;
+            } else {
+                memcpy(&token->value.doubleValue, &bits, sizeof(bits));
+            }
+        }
+    }
+    if (tokenList->size != count) {
+        fprintf(stderr, "Error: token file '%s' is corrupt at token %zu\n", filename, tokenList->size);
+        freeTokenList(tokenList);
+        return 0;
+    }
+    return 1;
+}
+
+// Parse the tokens the lexer produced, in memory.
+Node* parseTokenList(const TokenList *tokenList, Arena *nodes, int *errorCount) {
+    // Most tokens become one node; the arena grows past the hint if needed
+    arenaInit(nodes, (tokenList->size + 1) * sizeof(Node));
+    int errors;
+    Node* ast = parse(tokenList, nodes, &errors);
+    if (errorCount != NULL) {
+        *errorCount = errors;
+    }
+    return ast;
+}
+
+enum TokenType getTokenTypeFromString(const char* typeString) {
+    int found;
+    enum TokenType type = tokenTypeFromString(typeString, strlen(typeString), &found);
+    if (!found) {
+        fprintf(stderr, "Error: Unknown token type: %s\n", typeString);
+    }
+    return type;
+}
+
+// Convert a token dump written by writeTokensToJson() into a token list. Every token is
+// decoded here once; the lexemes are copied into one block of the list's arena.
+static int tokenListFromJson(cJSON *json, TokenList *tokenList) {
+    cJSON *tokens = cJSON_GetObjectItemCaseSensitive(json, "tokens");
+    if (!cJSON_IsArray(tokens)) {
+        fprintf(stderr, "Error: field 'tokens' isn't an array.\n");
+        return 0;
+    }
+
+    size_t count = 0;
+    size_t textLength = 0;
+    cJSON *token;
+    cJSON_ArrayForEach(token, tokens) {
+        cJSON *lexeme = cJSON_GetObjectItemCaseSensitive(token, "lexeme");
+        if (cJSON_IsString(lexeme)) {
+            textLength += strlen(lexeme->valuestring);
+        }
+        count++;
+    }
+
+    initTokenList(tokenList, NULL, count);
+    char *text = (char *)arenaAlloc(&tokenList->arena, textLength + 1);
+    tokenList->source = text;
+    cJSON_ArrayForEach(token, tokens) {
+        cJSON *type = cJSON_GetObjectItemCaseSensitive(token, "type");
+        cJSON *lexeme = cJSON_GetObjectItemCaseSensitive(token, "lexeme");
+        cJSON *value = cJSON_GetObjectItemCaseSensitive(token, "value");
+        enum TokenType tokenType = cJSON_IsString(type) ? getTokenTypeFromString(type->valuestring) : TOKEN_ERROR;
+        size_t length = cJSON_IsString(lexeme) ? strlen(lexeme->valuestring) : 0;
+        memcpy(text, length > 0 ? lexeme->valuestring : "", length);
+
+        Token *added = addToken(tokenList, tokenType, text, length);
+        if (tokenType == TOKEN_IDENTIFIER) {
+            added->value.symbol = internSymbol(text, length);
+        } else if (tokenType == TOKEN_INT_LITERAL && cJSON_IsNumber(value)) {
+            added->value.intValue = value->valueint;
+        } else if (tokenType == TOKEN_DOUBLE_LITERAL && cJSON_IsNumber(value)) {
+            added->value.doubleValue = value->valuedouble;
+        }
+        text += length;
+    }
+    return 1;
+}
+
+// Parse a token dump previously written by writeTokensToJson().
+Node* Parser(Arena *nodes) {
+    arenaInit(nodes, 0);    // left empty when there is nothing to parse
+    FILE *file = fopen("./output.json", "r");
+    if (!file) {
+        printf("Error during opening the file output.json\n");
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *json_data = (char *)malloc(file_size + 1);
+    fread(json_data, 1, file_size, file);
+    fclose(file);
+    json_data[file_size] = '\0';
+    cJSON *json_data_parsed = cJSON_Parse(json_data);
+    if (!json_data_parsed) {
+        const char *error_ptr = cJSON_GetErrorPtr();
+        if (error_ptr != NULL) {
+            fprintf(stderr, "Error printing JSON: %s\n", error_ptr);
+        }
+        free(json_data);
+        return NULL;
+    }
+    free(json_data);
+    TokenList tokenList;
+    int loaded = tokenListFromJson(json_data_parsed, &tokenList);
+    cJSON_Delete(json_data_parsed);
+    if (!loaded) {
+        return NULL;
+    }
+    Node* ast = parseTokenList(&tokenList, nodes, NULL);
+    printf("finished");
+    freeTokenList(&tokenList);
+    return ast;
+}
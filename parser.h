@@ -1,20 +1,41 @@
-#ifndef PARSER_H
-#define PARSER_H
-#include "cJSON.h"
-#include "lexer.h"
-//#include "cJSON.c"
-
-
-
-typedef struct Node {
-    TokenType type;
-    char lexeme[50];
-    int intValue;
-    double doubleValue;
-    struct Node* left;
-    struct Node* right;
-} Node;
-
-Node* Parser();
-
-#endif
+#ifndef PARSER_H
+#define PARSER_H
+#include <stdint.h>
+#include "cJSON.h"
+#include "lexer.h"
+//#include "cJSON.c"
+
+
+
+// A tree node is a one-byte opcode (the TokenType it came from) and a payload chosen by it:
+// the value of an int or double literal, the interned name of an identifier, the statements
+// of a block (TOKEN_NEW_LINE), or the two children of every other node. Names live in the
+// interner, so they are never truncated.
+typedef struct Node {
+    uint8_t type;               // a TokenType
+    union {
+        struct {
+            struct Node* left;
+            struct Node* right;
+        };
+        struct {
+            struct Node** statements;   // TOKEN_NEW_LINE, in the order they run
+            int statementCount;
+        };
+        int intValue;           // TOKEN_INT_LITERAL
+        double doubleValue;     // TOKEN_DOUBLE_LITERAL
+        SymbolId symbol;        // TOKEN_IDENTIFIER
+    };
+} Node;
+
+// Parse the tokens into a tree whose nodes all live in *nodes, which this initialises;
+// arenaFree(nodes) releases the whole tree at once. Syntax errors are reported on stderr
+// as they are found; errorCount, when not NULL, receives how many there were.
+Node* parseTokenList(const TokenList *tokenList, Arena *nodes, int *errorCount);
+
+int readTokensBinary(const char *filename, TokenList *tokenList);
+
+// Parse the tokens of ./output.json; the tree lives in *nodes as for parseTokenList()
+Node* Parser(Arena *nodes);
+
+#endif
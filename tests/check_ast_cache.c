@@ -0,0 +1,173 @@
+// check_ast_cache.c - the AST cache directory stays within AST_CACHE_MAX_ENTRIES: a write
+// past the bound evicts the least recently used entry, a hit counts as a use, leftover
+// temporary files go first and files the cache did not make are left alone. Each entry is
+// given its own modification time as it is written, so the order does not depend on how
+// fast the check runs.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "fold.h"
+#include "lexer.h"
+#include "parser.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Sources of distinct programs, one per entry
+static size_t programSource(char *source, size_t size, int number) {
+    return (size_t)snprintf(source, size, "print %d\nend\n", number);
+}
+
+static int writeProgram(const char *directory, int number) {
+    char source[64];
+    size_t length = programSource(source, sizeof(source), number);
+    TokenList tokens = tokenize(source, length);
+    Arena nodes;
+    int errors;
+    Node *root = foldConstants(parseTokenList(&tokens, &nodes, &errors));
+    FlatAst flat;
+    flattenAst(root, &flat);
+    int ok = errors == 0 && writeAstCache(directory, source, length, &flat);
+    freeFlatAst(&flat);
+    arenaFree(&nodes);
+    freeTokenList(&tokens);
+    return ok;
+}
+
+static int loadProgram(const char *directory, int number) {
+    char source[64];
+    size_t length = programSource(source, sizeof(source), number);
+    FlatAst flat;
+    if (!loadAstCache(directory, source, length, &flat)) {
+        return 0;
+    }
+    freeFlatAst(&flat);
+    return 1;
+}
+
+// Visit every file of the directory but . and ..; returns how many there are
+static int forEachFile(const char *directory, void (*visit)(const char *path, void *context), void *context) {
+    DIR *dir = opendir(directory);
+    int count = 0;
+    struct dirent *item;
+    while (dir && (item = readdir(dir)) != NULL) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+        if (visit) {
+            visit(path, context);
+        }
+        count++;
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    return count;
+}
+
+typedef struct {
+    time_t newerThan;
+    time_t modified;
+} Aging;
+
+// Files modified after newerThan, which is only ever the one just written or loaded, are
+// given the modification time `modified`
+static void ageFile(const char *path, void *context) {
+    const Aging *aging = (const Aging *)context;
+    struct stat info;
+    if (stat(path, &info) == 0 && info.st_mtime > aging->newerThan) {
+        struct timespec times[2] = {{aging->modified, 0}, {aging->modified, 0}};
+        utimensat(AT_FDCWD, path, times, 0);
+    }
+}
+
+static void removeFile(const char *path, void *context) {
+    (void)context;
+    remove(path);
+}
+
+static int fileExists(const char *directory, const char *name) {
+    char path[1024];
+    struct stat info;
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    return stat(path, &info) == 0;
+}
+
+static int writeFile(const char *directory, const char *name, time_t modified) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    FILE *file = fopen(path, "wb");
+    if (!file || fputs("not an entry\n", file) < 0 || fclose(file) != 0) {
+        return 0;
+    }
+    struct timespec times[2] = {{modified, 0}, {modified, 0}};
+    return utimensat(AT_FDCWD, path, times, 0) == 0;
+}
+
+int main(void) {
+    char directory[] = "/tmp/check_ast_cache.XXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    int failures = 0;
+    // Entry n is modified at base + n seconds, well before the check runs
+    time_t base = time(NULL) - 100000;
+    Aging aging = {base + 50000, 0};
+
+    // A temporary file left by a writer that died, older than any entry, and a stranger
+    failures += !writeFile(directory, "0123456789abcdef.99.tmp", base - 1);
+    failures += !writeFile(directory, "notes.txt", base - 1);
+    for (int n = 0; n < AST_CACHE_MAX_ENTRIES - 1; n++) {
+        failures += !writeProgram(directory, n);
+        aging.modified = base + n;
+        forEachFile(directory, ageFile, &aging);
+    }
+    if (forEachFile(directory, NULL, NULL) != AST_CACHE_MAX_ENTRIES + 1) {
+        fprintf(stderr, "%d files in the cache before it is full\n", forEachFile(directory, NULL, NULL));
+        failures++;
+    }
+
+    // Entry 0 is used, so entry 1 becomes the least recently used one
+    failures += !loadProgram(directory, 0);
+    for (int n = AST_CACHE_MAX_ENTRIES - 1; n < AST_CACHE_MAX_ENTRIES + 1; n++) {
+        failures += !writeProgram(directory, n);
+        aging.modified = base + n;
+        forEachFile(directory, ageFile, &aging);
+    }
+    int files = forEachFile(directory, NULL, NULL);
+    if (files != AST_CACHE_MAX_ENTRIES + 1) {
+        fprintf(stderr, "%d files in the cache, expected %d entries and notes.txt\n", files, AST_CACHE_MAX_ENTRIES);
+        failures++;
+    }
+    if (fileExists(directory, "0123456789abcdef.99.tmp") || !fileExists(directory, "notes.txt")) {
+        fprintf(stderr, "eviction kept the temporary file or removed notes.txt\n");
+        failures++;
+    }
+    if (!loadProgram(directory, 0) || loadProgram(directory, 1) || !loadProgram(directory, 2) ||
+        !loadProgram(directory, AST_CACHE_MAX_ENTRIES)) {
+        fprintf(stderr, "eviction did not remove just the least recently used entry\n");
+        failures++;
+    }
+
+    forEachFile(directory, removeFile, NULL);
+    rmdir(directory);
+    if (failures > 0) {
+        fprintf(stderr, "%d AST cache checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+#else
+int main(void) {
+    printf("the AST cache is not used on Windows, skipped\n");
+    return EXIT_SUCCESS;
+}
+#endif
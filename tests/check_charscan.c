@@ -0,0 +1,136 @@
+// check_charscan.c - every kernel set this CPU can run (scalar, SSE2, AVX2) must measure the
+// same identifier, digit and blank runs as a plain byte loop, for every run length up to and
+// past two AVX2 vectors, with every byte value ending the run, at unaligned starts. Buffers
+// are allocated at their exact length, so a sanitizer build also catches reads past the end.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "charscan.h"
+
+#define CHECK_MAX_LENGTH 80
+#define CHECK_RANDOM_BUFFERS 20000
+
+typedef size_t (*RunFunction)(const char *p, const char *end);
+
+typedef struct {
+    const char *name;
+    RunFunction run;
+    int (*member)(unsigned char c);
+    const char *members;        // bytes to build runs from
+} RunKind;
+
+// Written out from the language's definitions rather than read from charClassTable, so a
+// wrong table entry is caught too
+static int isIdentifierByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+static int isDigitByte(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int isSpaceByte(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static const RunKind runKinds[] = {
+        {"identifier", scanIdentifierRun, isIdentifierByte,
+         "abcxyzABCXYZ_0189"},
+        {"digit", scanDigitRun, isDigitByte, "0123456789"},
+        {"space", scanSpaceRun, isSpaceByte, " \t\v\f\r"},
+};
+
+static size_t expectedRun(const RunKind *kind, const char *p, const char *end) {
+    const char *start = p;
+    while (p < end && kind->member((unsigned char)*p)) p++;
+    return (size_t)(p - start);
+}
+
+// Measure the run in a copy of bytes[0..length) placed offset bytes into an allocation that
+// ends where it does
+static int checkBuffer(const RunKind *kind, const char *bytes, size_t length, size_t offset) {
+    char *copy = (char *)malloc(offset + length > 0 ? offset + length : 1);
+    if (!copy) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    char *start = copy + offset;
+    memcpy(start, bytes, length);
+    size_t expected = expectedRun(kind, start, start + length);
+    size_t actual = kind->run(start, start + length);
+    free(copy);
+    if (actual != expected) {
+        fprintf(stderr, "%s kernels, %s run over %zu bytes at offset %zu: %zu, expected %zu\n", charScanKernelName(),
+                kind->name, length, offset, actual, expected);
+        return 0;
+    }
+    return 1;
+}
+
+static int checkKernels(void) {
+    int failures = 0;
+    char bytes[CHECK_MAX_LENGTH];
+    for (size_t k = 0; k < sizeof(runKinds) / sizeof(runKinds[0]); k++) {
+        const RunKind *kind = &runKinds[k];
+        size_t memberCount = strlen(kind->members);
+
+        // A run of every length, ended by each of the 256 byte values or by the buffer end
+        for (size_t length = 0; length <= CHECK_MAX_LENGTH; length++) {
+            for (size_t i = 0; i < length; i++) {
+                bytes[i] = kind->members[i % memberCount];
+            }
+            failures += !checkBuffer(kind, bytes, length, length % 32);
+            for (size_t stop = 0; stop < length; stop++) {
+                for (int c = 0; c < 256; c++) {
+                    bytes[stop] = (char)c;
+                    failures += !checkBuffer(kind, bytes, length, (stop + (size_t)c) % 32);
+                }
+                bytes[stop] = kind->members[stop % memberCount];
+            }
+        }
+
+        // Mostly members with the odd other byte, including the high half of the table
+        srand(1);
+        for (int n = 0; n < CHECK_RANDOM_BUFFERS; n++) {
+            size_t length = (size_t)rand() % (CHECK_MAX_LENGTH + 1);
+            for (size_t i = 0; i < length; i++) {
+                bytes[i] = rand() % 16 ? kind->members[rand() % memberCount] : (char)(rand() % 256);
+            }
+            failures += !checkBuffer(kind, bytes, length, (size_t)rand() % 32);
+        }
+    }
+    return failures;
+}
+
+int main(void) {
+    static const char *const names[] = {"scalar", "sse2", "avx2"};
+    const char *picked = charScanKernelName();
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (!useCharScanKernels(names[i])) {
+            printf("%s kernels: not supported here, skipped\n", names[i]);
+            continue;
+        }
+        int kernelFailures = checkKernels();
+        printf("%s kernels: %s\n", names[i], kernelFailures ? "FAILED" : "ok");
+        failures += kernelFailures;
+    }
+
+    // The load-time choice must be the best set that ran above
+    for (size_t i = sizeof(names) / sizeof(names[0]); i-- > 0;) {
+        if (useCharScanKernels(names[i])) {
+            if (strcmp(picked, names[i]) != 0) {
+                fprintf(stderr, "%s kernels were picked at load time, %s is supported\n", picked, names[i]);
+                failures++;
+            }
+            break;
+        }
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "%d character scan checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// check_deep_expressions.c - the parser, the folding pass and flattening keep their work on
+// the heap, so an expression nested or chained 200k deep parses to the right tree and folds
+// to the right value on a default-sized C stack instead of overflowing it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "fold.h"
+#include "lexer.h"
+#include "parser.h"
+
+#define CHECK_DEPTH 200000
+
+// Text of prefix, then repeated count times, middle, closing count times, and suffix
+static char *buildSource(const char *prefix, const char *repeated, size_t count, const char *middle,
+                         const char *closing, const char *suffix, size_t *length) {
+    size_t size = strlen(prefix) + count * (strlen(repeated) + strlen(closing)) + strlen(middle) + strlen(suffix);
+    char *source = (char *)malloc(size + 1);
+    if (!source) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    char *p = source;
+    p += sprintf(p, "%s", prefix);
+    for (size_t i = 0; i < count; i++) {
+        p += sprintf(p, "%s", repeated);
+    }
+    p += sprintf(p, "%s", middle);
+    for (size_t i = 0; i < count; i++) {
+        p += sprintf(p, "%s", closing);
+    }
+    p += sprintf(p, "%s", suffix);
+    *length = (size_t)(p - source);
+    return source;
+}
+
+// Parse source, hand the first statement whose type is `type` to `check`, then fold and
+// flatten the program; the folded statement goes to `checkFolded` when it is not NULL
+static int checkProgram(const char *label, const char *source, size_t length, TokenType type,
+                        int (*check)(const Node *), int (*checkFolded)(const Node *)) {
+    TokenList tokens = tokenize(source, length);
+    Arena nodes;
+    int errors;
+    Node *root = parseTokenList(&tokens, &nodes, &errors);
+    const Node *statement = NULL;
+    for (int i = 0; root && root->type == TOKEN_NEW_LINE && i < root->statementCount && !statement; i++) {
+        statement = root->statements[i]->type == type ? root->statements[i] : NULL;
+    }
+    int ok = errors == 0 && statement && check(statement);
+    if (ok) {
+        root = foldConstants(root);
+        ok = !checkFolded || checkFolded(statement);
+    }
+    if (ok) {
+        FlatAst flat;
+        flattenAst(root, &flat);
+        ok = flat.size > 0;
+        freeFlatAst(&flat);
+    }
+    arenaFree(&nodes);
+    freeTokenList(&tokens);
+    if (!ok) {
+        fprintf(stderr, "%s: wrong tree\n", label);
+    }
+    return ok;
+}
+
+static int isLiteral(const Node *node, double value) {
+    return node && ((node->type == TOKEN_INT_LITERAL && node->intValue == value) ||
+                    (node->type == TOKEN_DOUBLE_LITERAL && node->doubleValue == value));
+}
+
+// x = 1 + (((...1...))): the parentheses leave no nodes behind
+static int isOnePlusOne(const Node *assign) {
+    const Node *sum = assign->right;
+    return sum && sum->type == TOKEN_PLUS && isLiteral(sum->left, 1) && isLiteral(sum->right, 1);
+}
+
+static int isTwo(const Node *assign) {
+    return isLiteral(assign->right, 2);
+}
+
+// x = 1 < 2 < 2 ...: grouped to the right, 1 < (2 < (2 < ...))
+static int isRelationalChain(const Node *assign) {
+    const Node *node = assign->right;
+    for (int i = 0; i < CHECK_DEPTH; i++) {
+        if (!node || node->type != TOKEN_LESS || !isLiteral(node->left, i == 0 ? 1 : 2)) {
+            return 0;
+        }
+        node = node->right;
+    }
+    return isLiteral(node, 2);
+}
+
+static int isZero(const Node *assign) {
+    return isLiteral(assign->right, 0);
+}
+
+// print print ... 1: each print is the operand of the one before
+static int isPrintChain(const Node *print) {
+    const Node *node = print;
+    for (int i = 0; i < CHECK_DEPTH; i++) {
+        if (!node || node->type != TOKEN_PRINT) {
+            return 0;
+        }
+        node = node->right;
+    }
+    return isLiteral(node, 1);
+}
+
+int main(void) {
+    int failures = 0;
+    size_t length;
+    char *source;
+
+    source = buildSource("#i x\nx = 1 + ", "(", CHECK_DEPTH, "1", ")", "\nprint x\nend\n", &length);
+    failures += !checkProgram("deep parentheses", source, length, TOKEN_ASSIGN, isOnePlusOne, isTwo);
+    free(source);
+
+    source = buildSource("#i x\nx = 1", " < 2", CHECK_DEPTH, "", "", "\nprint x\nend\n", &length);
+    failures += !checkProgram("long relational chain", source, length, TOKEN_ASSIGN, isRelationalChain, isZero);
+    free(source);
+
+    source = buildSource("", "print ", CHECK_DEPTH, "1", "", "\nend\n", &length);
+    failures += !checkProgram("long print chain", source, length, TOKEN_PRINT, isPrintChain, NULL);
+    free(source);
+
+    if (failures > 0) {
+        fprintf(stderr, "%d deep expression checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
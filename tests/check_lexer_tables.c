@@ -0,0 +1,141 @@
+// check_lexer_tables.c - the tables lexgen generated from tokens.def must agree with it: each
+// token type name has its own slot in the perfect hash and anything else is turned away, and
+// the DFA reads every fixed spelling and keyword as its token. Run after it is built, so a
+// tokens.def change the generator mishandles fails the build.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "lexer_tables.h"
+
+typedef struct {
+    TokenType type;
+    const char *name;
+    int kind;
+    const char *spelling;
+} TokenEntry;
+
+// The kinds of tokens.def entries, as lexgen.c numbers them
+enum { TK_FIXED, TK_KEYWORD, TK_PATTERN, TK_NONE };
+
+static const TokenEntry entries[] = {
+#define TOKEN(name, kind, spelling) {TOKEN_##name, "TOKEN_" #name, kind, spelling},
+#include "tokens.def"
+#undef TOKEN
+};
+
+static const size_t entryCount = sizeof(entries) / sizeof(entries[0]);
+
+static int checkName(const TokenEntry *entry) {
+    size_t length = strlen(entry->name);
+    int slot = lexNameSlots[lexNameHash(entry->name, length) >> LEX_NAME_SHIFT];
+    int found;
+    TokenType type = tokenTypeFromString(entry->name, length, &found);
+    if (slot != (int)entry->type || !found || type != entry->type) {
+        fprintf(stderr, "%s: hash slot holds %d, looked up as %s\n", entry->name, slot,
+                found ? tokenTypeToString(type) : "not found");
+        return 0;
+    }
+    return 1;
+}
+
+static int isEntryName(const char *name, size_t length) {
+    for (size_t i = 0; i < entryCount; i++) {
+        if (strncmp(entries[i].name, name, length) == 0 && entries[i].name[length] == '\0') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int checkNotName(const char *name, size_t length) {
+    if (isEntryName(name, length)) {
+        return 1;           // a near miss of one name can be another, as TOKEN_LESS is of TOKEN_LESS_OR_EQUAL
+    }
+    int found;
+    TokenType type = tokenTypeFromString(name, length, &found);
+    if (found || type != TOKEN_ERROR) {
+        fprintf(stderr, "\"%.*s\" is not a token type but was looked up as %s\n", (int)length, name,
+                tokenTypeToString(type));
+        return 0;
+    }
+    return 1;
+}
+
+// Near misses of one name: every proper prefix, a byte more, and each byte changed
+static int checkNearMisses(const TokenEntry *entry) {
+    char name[64];
+    size_t length = strlen(entry->name);
+    int failures = 0;
+    if (length + 2 > sizeof(name)) {
+        fprintf(stderr, "%s: name too long to check\n", entry->name);
+        return 1;
+    }
+    memcpy(name, entry->name, length + 1);
+    for (size_t i = 0; i < length; i++) {
+        failures += !checkNotName(name, i);
+    }
+    name[length] = '_';
+    failures += !checkNotName(name, length + 1);
+    for (size_t i = 0; i < length; i++) {
+        char original = name[i];
+        name[i] = original == 'X' ? 'Y' : 'X';
+        failures += !checkNotName(name, length);
+        name[i] = original;
+    }
+    return failures;
+}
+
+// The spelling lexes as one token of the entry's type, followed by a name since '=' needs an
+// operand after it; a keyword with a letter after it is a name instead
+static int checkSpelling(const TokenEntry *entry) {
+    char source[64];
+    size_t length = strlen(entry->spelling);
+    snprintf(source, sizeof(source), "%s a", entry->spelling);
+    TokenList tokens = tokenize(source, length + 2);
+    int ok = tokens.size >= 1 && tokens.tokens[0].type == entry->type && tokens.tokens[0].offset == 0 &&
+             tokens.tokens[0].length == length;
+    freeTokenList(&tokens);
+    if (!ok) {
+        fprintf(stderr, "%s: \"%s\" does not lex as it\n", entry->name, entry->spelling);
+        return 0;
+    }
+    if (entry->kind == TK_KEYWORD) {
+        char longer[64];
+        snprintf(longer, sizeof(longer), "%sx", entry->spelling);
+        tokens = tokenize(longer, length + 1);
+        ok = tokens.size >= 1 && tokens.tokens[0].type == TOKEN_IDENTIFIER && tokens.tokens[0].length == length + 1;
+        freeTokenList(&tokens);
+        if (!ok) {
+            fprintf(stderr, "%s: \"%s\" does not lex as a name\n", entry->name, longer);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+    int failures = 0;
+    for (size_t i = 0; i < entryCount; i++) {
+        if (entries[i].type != (TokenType)i) {
+            fprintf(stderr, "%s is numbered %d, expected %zu\n", entries[i].name, (int)entries[i].type, i);
+            failures++;
+        }
+        failures += !checkName(&entries[i]);
+        failures += checkNearMisses(&entries[i]);
+        if (entries[i].kind == TK_FIXED || entries[i].kind == TK_KEYWORD) {
+            failures += !checkSpelling(&entries[i]);
+        }
+    }
+    static const char *const strangers[] = {"", "TOKEN", "TOKEN_", "PLUS", "token_plus", "TOKEN_UNKNOWN",
+                                            "UNKNOWN_TOKEN"};
+    for (size_t i = 0; i < sizeof(strangers) / sizeof(strangers[0]); i++) {
+        failures += !checkNotName(strangers[i], strlen(strangers[i]));
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "%d lexer table checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+// check_parallel_lexer.c - tokenizeParallel() must hand out exactly the tokens tokenize()
+// does on every thread count, including when an error or "end" part way through stops the
+// lex and the chunks after it have to be thrown away.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "programgen.h"
+
+// Large enough for nine chunks of PARALLEL_LEX_MIN_CHUNK
+#define CHECK_PROGRAM_BYTES (10 * PARALLEL_LEX_MIN_CHUNK)
+#define CHECK_MAX_THREADS 9
+
+static int sameToken(const Token *expected, const Token *actual) {
+    if (expected->type != actual->type || expected->offset != actual->offset || expected->length != actual->length) {
+        return 0;
+    }
+    switch (expected->type) {
+        case TOKEN_INT_LITERAL:
+            return expected->value.intValue == actual->value.intValue;
+        case TOKEN_DOUBLE_LITERAL:
+            return expected->value.doubleValue == actual->value.doubleValue;
+        case TOKEN_IDENTIFIER:
+            return expected->value.symbol == actual->value.symbol;
+        default:
+            return 1;
+    }
+}
+
+// A copy of program with the line `line` inserted at the start of the first line at or after
+// fraction of the way through, or an unchanged copy for a negative fraction
+static char *insertLine(const char *program, size_t length, double fraction, const char *line, size_t *newLength) {
+    size_t lineLength = fraction < 0 ? 0 : strlen(line) + 1;
+    char *source = (char *)malloc(length + lineLength);
+    if (!source) {
+        perror("Memory allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    size_t at = length;
+    if (fraction >= 0) {
+        at = (size_t)(length * fraction);
+        while (at > 0 && at < length && program[at - 1] != '\n') {
+            at++;
+        }
+    }
+    memcpy(source, program, at);
+    memcpy(source + at, line, lineLength > 0 ? lineLength - 1 : 0);
+    if (lineLength > 0) {
+        source[at + lineLength - 1] = '\n';
+    }
+    memcpy(source + at + lineLength, program + at, length - at);
+    *newLength = length + lineLength;
+    return source;
+}
+
+static int matchesTokenize(const char *source, size_t length, const char *label) {
+    TokenList expected = tokenize(source, length);
+    int ok = 1;
+    for (int threads = 2; ok && threads <= CHECK_MAX_THREADS; threads++) {
+        TokenList actual = tokenizeParallel(source, length, threads);
+        size_t i = 0;
+        while (i < expected.size && i < actual.size && sameToken(&expected.tokens[i], &actual.tokens[i])) {
+            i++;
+        }
+        if (i < expected.size || i < actual.size) {
+            fprintf(stderr, "%s, %d threads: token %zu of %zu differs from tokenize(), which gave %zu\n", label,
+                    threads, i, actual.size, expected.size);
+            ok = 0;
+        }
+        freeTokenList(&actual);
+    }
+    freeTokenList(&expected);
+    return ok;
+}
+
+int main(void) {
+    size_t length;
+    char *program = generateProgram(CHECK_PROGRAM_BYTES, 1, &length);
+    // An error or "end" in the first line, in the first, middle and last chunks, and none
+    static const double fractions[] = {-1, 0, 0.05, 0.5, 0.97};
+    static const char *const lines[] = {"x = 1 $ 2", "end"};
+    int failures = 0;
+    for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+        for (size_t l = 0; l < sizeof(lines) / sizeof(lines[0]); l++) {
+            if (fractions[f] < 0 && l > 0) {
+                continue;
+            }
+            size_t sourceLength;
+            char *source = insertLine(program, length, fractions[f], lines[l], &sourceLength);
+            char label[64];
+            snprintf(label, sizeof(label), "\"%s\" at %.0f%%", fractions[f] < 0 ? "nothing" : lines[l],
+                     fractions[f] < 0 ? 0 : fractions[f] * 100);
+            failures += !matchesTokenize(source, sourceLength, label);
+            free(source);
+        }
+    }
+    free(program);
+
+    if (failures > 0) {
+        fprintf(stderr, "%d parallel lexer checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+// check_stream_lexer.c - the stream lexer must hand out exactly the tokens tokenize() does,
+// whatever the window size, so lexemes that straddle a window edge come out whole; and a
+// lexeme that cannot fit in the window must end the stream with an error token.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "programgen.h"
+
+#define CHECK_INPUT_FILE "check_stream_lexer_input.iw"
+
+static int writeFile(const char *filename, const char *data, size_t length) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        perror("Could not open output file");
+        return 0;
+    }
+    int ok = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && ok;
+}
+
+static int sameValue(const Token *expected, const Token *actual) {
+    switch (expected->type) {
+        case TOKEN_INT_LITERAL:
+            return expected->value.intValue == actual->value.intValue;
+        case TOKEN_DOUBLE_LITERAL:
+            return expected->value.doubleValue == actual->value.doubleValue;
+        case TOKEN_IDENTIFIER:
+            return expected->value.symbol == actual->value.symbol;
+        default:
+            return 1;
+    }
+}
+
+// Stream source through a window of windowSize bytes, batchSize tokens per call, and
+// compare every token and its text with tokenize(); returns 1 when they all match
+static int matchesTokenize(const char *source, size_t length, size_t windowSize, size_t batchSize) {
+    TokenList expected = tokenize(source, length);
+    if (!writeFile(CHECK_INPUT_FILE, source, length)) {
+        freeTokenList(&expected);
+        return 0;
+    }
+    StreamLexer lexer;
+    if (!streamLexerOpen(&lexer, CHECK_INPUT_FILE, windowSize)) {
+        freeTokenList(&expected);
+        return 0;
+    }
+
+    Token batch[16];
+    size_t seen = 0;
+    int ok = 1;
+    size_t count;
+    while (ok && (count = streamLexerNextBatch(&lexer, batch, batchSize)) > 0) {
+        // Every lexeme of a batch stays readable until the next call
+        for (size_t i = 0; ok && i < count; i++, seen++) {
+            const Token *actual = &batch[i];
+            const Token *wanted = seen < expected.size ? &expected.tokens[seen] : NULL;
+            ok = wanted && actual->type == wanted->type && actual->offset == wanted->offset &&
+                 actual->length == wanted->length && sameValue(wanted, actual) &&
+                 memcmp(streamLexerLexeme(&lexer, actual), source + wanted->offset, wanted->length) == 0;
+            if (!ok) {
+                fprintf(stderr, "window %zu, batch %zu: token %zu (%s at offset %zu) differs from tokenize()\n",
+                        windowSize, batchSize, seen, tokenTypeToString(actual->type), actual->offset);
+            }
+        }
+    }
+    if (ok && seen != expected.size) {
+        fprintf(stderr, "window %zu, batch %zu: %zu tokens, tokenize() gave %zu\n", windowSize, batchSize, seen,
+                expected.size);
+        ok = 0;
+    }
+    streamLexerClose(&lexer);
+    freeTokenList(&expected);
+    return ok;
+}
+
+// A name of nameLength bytes in a window of windowSize: it lexes normally while it fits
+// with the byte that ends it, and otherwise the stream stops with an error token at it
+static int checkLongLexeme(size_t nameLength, size_t windowSize) {
+    const char *prefix = "#i ";
+    size_t length = strlen(prefix) + nameLength + 1;
+    char *source = (char *)malloc(length);
+    if (!source) {
+        return 0;
+    }
+    memcpy(source, prefix, strlen(prefix));
+    memset(source + strlen(prefix), 'a', nameLength);
+    source[length - 1] = '\n';
+
+    int ok;
+    if (nameLength < windowSize) {
+        ok = matchesTokenize(source, length, windowSize, 1);
+    } else {
+        ok = writeFile(CHECK_INPUT_FILE, source, length);
+        StreamLexer lexer;
+        ok = ok && streamLexerOpen(&lexer, CHECK_INPUT_FILE, windowSize);
+        if (ok) {
+            Token token;
+            ok = streamLexerNext(&lexer, &token) && token.type == TOKEN_INT_DECL &&
+                 streamLexerNext(&lexer, &token) && token.type == TOKEN_ERROR && token.offset == strlen(prefix) &&
+                 !streamLexerNext(&lexer, &token);
+            streamLexerClose(&lexer);
+        }
+        if (!ok) {
+            fprintf(stderr, "a %zu-byte name in a %zu-byte window was not rejected\n", nameLength, windowSize);
+        }
+    }
+    free(source);
+    return ok;
+}
+
+int main(void) {
+    int failures = 0;
+
+    // Every window size in the range moves the window edges across different lexemes
+    for (unsigned seed = 1; seed <= 4; seed++) {
+        size_t length;
+        char *program = generateProgram(3000, seed, &length);
+        for (size_t window = 32; window <= 96; window++) {
+            failures += !matchesTokenize(program, length, window, 1);
+            failures += !matchesTokenize(program, length, window, 16);
+        }
+        failures += !matchesTokenize(program, length, STREAM_LEXER_WINDOW, 16);
+        free(program);
+    }
+
+    for (size_t nameLength = 24; nameLength <= 40; nameLength++) {
+        failures += !checkLongLexeme(nameLength, 32);
+    }
+
+    remove(CHECK_INPUT_FILE);
+    if (failures > 0) {
+        fprintf(stderr, "%d stream lexer checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("stream lexer matches tokenize()\n");
+    return EXIT_SUCCESS;
+}